@@ -1,9 +1,18 @@
 #include "devices/block.h"
+#include <histogram.h>
 #include <list.h>
 #include <string.h>
 #include <stdio.h>
 #include "devices/ide.h"
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/io.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/trace.h"
+#include "threads/vaddr.h"
 
 /* A block device. */
 struct block
@@ -19,8 +28,46 @@ struct block
 
     unsigned long long read_cnt;        /* Number of sectors read. */
     unsigned long long write_cnt;       /* Number of sectors written. */
+
+    /* If nonnull, requests are passed on to FORWARD, starting
+       FORWARD_OFS sectors in, instead of going to OPS. */
+    struct block *forward;
+    block_sector_t forward_ofs;
+
+    /* Request queue.  Protected by QUEUE->lock. */
+    struct block_queue *queue;          /* Queue serving us, if any. */
+    struct list_elem queue_elem;        /* Element in QUEUE->blocks. */
+    struct list sorted;                 /* Pending requests by sector. */
+    struct list fifo[2];                /* Pending reads, writes by age. */
+    size_t depth;                       /* Number of pending requests. */
+    block_sector_t next_sector;         /* Elevator position. */
+
+    /* Queue statistics. */
+    unsigned long long request_cnt;     /* Requests queued. */
+    unsigned long long merge_cnt;       /* Requests merged into others. */
+    unsigned long long depth_sum;       /* Sum of depth after each queuing. */
+    size_t max_depth;                   /* Greatest depth. */
+    struct histogram latency;           /* Submission to completion, cycles. */
   };
 
+/* A request queue, served by one worker thread. */
+struct block_queue
+  {
+    struct lock lock;                   /* Protects everything here. */
+    struct condition work;              /* Signaled on new requests. */
+    struct list blocks;                 /* Devices served, in turn. */
+  };
+
+/* Longest time, in timer ticks, that a read or a write may wait
+   in a queue before it is carried out ahead of any that would
+   reduce seeking. */
+#define READ_DEADLINE (TIMER_FREQ / 2)
+#define WRITE_DEADLINE (TIMER_FREQ * 5)
+
+/* Most sectors and requests merged into a single transfer. */
+#define MERGE_SECTORS 256
+#define MERGE_REQUESTS 32
+
 /* List of all block devices. */
 static struct list all_blocks = LIST_INITIALIZER (all_blocks);
 
@@ -28,6 +75,11 @@ static struct list all_blocks = LIST_INITIALIZER (all_blocks);
 static struct block *block_by_role[BLOCK_ROLE_CNT];
 
 static struct block *list_elem_to_block (struct list_elem *);
+static void transfer_sync (struct block *, block_sector_t, size_t cnt,
+                           void *buffer, bool write);
+static void carry_out (struct block *, struct block_request **, size_t cnt);
+static void complete (struct block *, struct block_request *);
+static thread_func queue_worker NO_RETURN;
 
 /* Returns a human-readable name for the given block device
    TYPE. */
@@ -120,9 +172,20 @@ check_sector (struct block *block, block_sector_t sector)
 void
 block_read (struct block *block, block_sector_t sector, void *buffer)
 {
-  check_sector (block, sector);
-  block->ops->read (block->aux, sector, buffer);
-  block->read_cnt++;
+  transfer_sync (block, sector, 1, buffer, false);
+}
+
+/* Reads CNT consecutive sectors starting at SECTOR from BLOCK
+   into BUFFER, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes.  Drivers that support it transfer all of them with as
+   few commands as possible.
+   Internally synchronizes accesses to block devices, so external
+   per-block device locking is unneeded. */
+void
+block_read_multiple (struct block *block, block_sector_t sector,
+                     size_t cnt, void *buffer)
+{
+  transfer_sync (block, sector, cnt, buffer, false);
 }
 
 /* Write sector SECTOR to BLOCK from BUFFER, which must contain
@@ -133,10 +196,402 @@ block_read (struct block *block, block_sector_t sector, void *buffer)
 void
 block_write (struct block *block, block_sector_t sector, const void *buffer)
 {
-  check_sector (block, sector);
-  ASSERT (block->type != BLOCK_FOREIGN);
-  block->ops->write (block->aux, sector, buffer);
-  block->write_cnt++;
+  transfer_sync (block, sector, 1, (void *) buffer, true);
+}
+
+/* Writes CNT consecutive sectors starting at SECTOR to BLOCK
+   from BUFFER, which must contain CNT * BLOCK_SECTOR_SIZE bytes.
+   Returns after the block device has acknowledged receiving the
+   data.  Drivers that support it transfer all of them with as
+   few commands as possible.
+   Internally synchronizes accesses to block devices, so external
+   per-block device locking is unneeded. */
+void
+block_write_multiple (struct block *block, block_sector_t sector,
+                      size_t cnt, const void *buffer)
+{
+  transfer_sync (block, sector, cnt, (void *) buffer, true);
+}
+
+/* Submits a request for CNT sectors at SECTOR on BLOCK to or
+   from BUFFER and waits for it to complete. */
+static void
+submit_wait (struct block *block, block_sector_t sector, size_t cnt,
+             void *buffer, bool write)
+{
+  struct block_request r;
+  struct semaphore done;
+
+  sema_init (&done, 0);
+  r.sector = sector;
+  r.cnt = cnt;
+  r.buffer = buffer;
+  r.write = write;
+  r.done = NULL;
+  r.sema = &done;
+  block_submit (block, &r);
+  sema_down (&done);
+}
+
+/* Transfers CNT sectors at SECTOR on BLOCK to or from BUFFER
+   and waits for the transfer to complete.
+
+   A queue's worker thread cannot see user virtual memory, so a
+   user BUFFER is copied through a kernel bounce buffer, a page
+   at a time.  The copying happens here, in the caller's address
+   space, so it may page fault just as if the caller had done it
+   itself. */
+static void
+transfer_sync (struct block *block, block_sector_t sector, size_t cnt,
+               void *buffer, bool write)
+{
+  uint8_t *user = buffer;
+  uint8_t *bounce;
+  size_t bounce_cnt;
+
+  if (cnt == 0)
+    return;
+  if (is_kernel_vaddr (buffer))
+    {
+      submit_wait (block, sector, cnt, buffer, write);
+      return;
+    }
+
+  /* Fall back to one sector at a time if no page is free. */
+  bounce = palloc_get_page (0);
+  if (bounce != NULL)
+    bounce_cnt = PGSIZE / BLOCK_SECTOR_SIZE;
+  else
+    {
+      bounce = malloc (BLOCK_SECTOR_SIZE);
+      if (bounce == NULL)
+        PANIC ("Failed to allocate block bounce buffer");
+      bounce_cnt = 1;
+    }
+
+  while (cnt > 0)
+    {
+      size_t chunk = cnt < bounce_cnt ? cnt : bounce_cnt;
+      size_t bytes = chunk * BLOCK_SECTOR_SIZE;
+
+      if (write)
+        memcpy (bounce, user, bytes);
+      submit_wait (block, sector, chunk, bounce, write);
+      if (!write)
+        memcpy (user, bounce, bytes);
+
+      sector += chunk;
+      cnt -= chunk;
+      user += bytes;
+    }
+
+  if (bounce_cnt > 1)
+    palloc_free_page (bounce);
+  else
+    free (bounce);
+}
+
+/* Returns true if request A starts at a lower sector than B. */
+static bool
+request_less (const struct list_elem *a_, const struct list_elem *b_,
+              void *aux UNUSED)
+{
+  const struct block_request *a
+    = list_entry (a_, struct block_request, sorted_elem);
+  const struct block_request *b
+    = list_entry (b_, struct block_request, sorted_elem);
+
+  return a->dev_sector < b->dev_sector;
+}
+
+/* Submits request R, whose submitter fields must be filled in,
+   to BLOCK, and returns without waiting for it to complete,
+   unless BLOCK has no request queue, in which case R is carried
+   out and completed before returning.  Must not be called from
+   an interrupt handler. */
+void
+block_submit (struct block *block, struct block_request *r)
+{
+  struct block_queue *q;
+
+  ASSERT (r->cnt > 0);
+  ASSERT (is_kernel_vaddr (r->buffer));
+  ASSERT (!intr_context ());
+
+  r->block = block;
+  r->dev_sector = r->sector;
+  for (;;)
+    {
+      check_sector (block, r->dev_sector);
+      check_sector (block, r->dev_sector + r->cnt - 1);
+      ASSERT (!r->write || block->type != BLOCK_FOREIGN);
+      if (r->write)
+        block->write_cnt += r->cnt;
+      else
+        block->read_cnt += r->cnt;
+
+      if (block->forward == NULL)
+        break;
+      r->dev_sector += block->forward_ofs;
+      block = block->forward;
+    }
+
+  r->submit_tsc = rdtsc ();
+  q = block->queue;
+  if (q == NULL)
+    {
+      carry_out (block, &r, 1);
+      return;
+    }
+
+  lock_acquire (&q->lock);
+  r->deadline = timer_ticks () + (r->write ? WRITE_DEADLINE : READ_DEADLINE);
+  list_insert_ordered (&block->sorted, &r->sorted_elem, request_less, NULL);
+  list_push_back (&block->fifo[r->write], &r->fifo_elem);
+  block->depth++;
+  block->request_cnt++;
+  block->depth_sum += block->depth;
+  if (block->depth > block->max_depth)
+    block->max_depth = block->depth;
+  cond_signal (&q->work, &q->lock);
+  lock_release (&q->lock);
+}
+
+/* Removes request R from BLOCK's queue. */
+static void
+dequeue (struct block *block, struct block_request *r)
+{
+  list_remove (&r->sorted_elem);
+  list_remove (&r->fifo_elem);
+  block->depth--;
+}
+
+/* Chooses the next requests to carry out on BLOCK, which must
+   have at least one pending, removes them from its queue, and
+   stores them in BATCH.  Returns the number stored, at most
+   MERGE_REQUESTS.
+
+   Normally this is the request at or after the elevator
+   position with the lowest sector, wrapping around to the
+   lowest sector overall (C-LOOK), but a read or write that has
+   been waiting past its deadline goes first.  Requests that
+   continue where the chosen one ends, in the same direction,
+   are merged into the batch. */
+static size_t
+choose_batch (struct block *block, struct block_request **batch)
+{
+  int64_t now = timer_ticks ();
+  struct block_request *r = NULL;
+  struct list_elem *e;
+  block_sector_t end;
+  size_t sectors, cnt;
+  int dir;
+
+  for (dir = 0; dir < 2 && r == NULL; dir++)
+    if (!list_empty (&block->fifo[dir]))
+      {
+        struct block_request *oldest
+          = list_entry (list_front (&block->fifo[dir]),
+                        struct block_request, fifo_elem);
+        if (oldest->deadline <= now)
+          r = oldest;
+      }
+  if (r == NULL)
+    {
+      for (e = list_begin (&block->sorted); e != list_end (&block->sorted);
+           e = list_next (e))
+        {
+          r = list_entry (e, struct block_request, sorted_elem);
+          if (r->dev_sector >= block->next_sector)
+            break;
+        }
+      if (e == list_end (&block->sorted))
+        r = list_entry (list_front (&block->sorted),
+                        struct block_request, sorted_elem);
+    }
+
+  e = list_next (&r->sorted_elem);
+  dequeue (block, r);
+  batch[0] = r;
+  cnt = 1;
+  sectors = r->cnt;
+  end = r->dev_sector + r->cnt;
+  while (cnt < MERGE_REQUESTS && e != list_end (&block->sorted))
+    {
+      struct block_request *next
+        = list_entry (e, struct block_request, sorted_elem);
+      if (next->dev_sector != end || next->write != r->write
+          || sectors + next->cnt > MERGE_SECTORS)
+        break;
+
+      e = list_next (e);
+      dequeue (block, next);
+      batch[cnt++] = next;
+      sectors += next->cnt;
+      end += next->cnt;
+    }
+
+  block->next_sector = end;
+  block->merge_cnt += cnt - 1;
+  return cnt;
+}
+
+/* Carries out request R on BLOCK, which must not forward. */
+static void
+transfer_one (struct block *block, struct block_request *r)
+{
+  const struct block_operations *ops = block->ops;
+  uint8_t *p = r->buffer;
+  size_t i;
+
+  if (r->cnt > 1 && !r->write && ops->read_multiple != NULL)
+    ops->read_multiple (block->aux, r->dev_sector, r->cnt, p);
+  else if (r->cnt > 1 && r->write && ops->write_multiple != NULL)
+    ops->write_multiple (block->aux, r->dev_sector, r->cnt, p);
+  else
+    for (i = 0; i < r->cnt; i++)
+      {
+        if (r->write)
+          ops->write (block->aux, r->dev_sector + i,
+                      p + i * BLOCK_SECTOR_SIZE);
+        else
+          ops->read (block->aux, r->dev_sector + i,
+                     p + i * BLOCK_SECTOR_SIZE);
+      }
+}
+
+/* Carries out the CNT requests in BATCH, which are for
+   consecutive sectors on BLOCK in the same direction, then
+   completes them.  If the driver supports vectored transfers,
+   the whole batch is a single transfer. */
+static void
+carry_out (struct block *block, struct block_request **batch, size_t cnt)
+{
+  struct block_request *first = batch[0];
+  size_t sectors = 0;
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    sectors += batch[i]->cnt;
+
+  TRACE (TRACE_BLOCK_ISSUE, first->sector, first->block->type,
+         sectors << 1 | first->write);
+  if (cnt > 1 && block->ops->transfer != NULL)
+    {
+      struct block_iovec iov[MERGE_REQUESTS];
+
+      for (i = 0; i < cnt; i++)
+        {
+          iov[i].buffer = batch[i]->buffer;
+          iov[i].cnt = batch[i]->cnt;
+        }
+      block->ops->transfer (block->aux, first->dev_sector, iov, cnt,
+                            first->write);
+    }
+  else
+    for (i = 0; i < cnt; i++)
+      transfer_one (block, batch[i]);
+  TRACE (TRACE_BLOCK_DONE, first->sector, first->block->type,
+         sectors << 1 | first->write);
+
+  for (i = 0; i < cnt; i++)
+    complete (block, batch[i]);
+}
+
+/* Records R's latency in BLOCK's statistics and notifies its
+   submitter.  R may be freed as soon as this happens. */
+static void
+complete (struct block *block, struct block_request *r)
+{
+  histogram_add (&block->latency, rdtsc () - r->submit_tsc);
+  if (r->done != NULL)
+    r->done (r);
+  if (r->sema != NULL)
+    sema_up (r->sema);
+}
+
+/* Creates a request queue and a worker thread, named NAME, to
+   serve it. */
+struct block_queue *
+block_queue_create (const char *name)
+{
+  struct block_queue *q = malloc (sizeof *q);
+  if (q == NULL)
+    PANIC ("Failed to allocate memory for block queue");
+
+  lock_init (&q->lock);
+  cond_init (&q->work);
+  list_init (&q->blocks);
+  if (thread_create (name, PRI_MAX, queue_worker, q) == TID_ERROR)
+    PANIC ("Failed to create block queue worker");
+  return q;
+}
+
+/* Has requests to BLOCK, which must be a device registered by a
+   driver, not forwarded, be carried out by Q's worker thread.
+   Must be called before any requests are submitted to BLOCK. */
+void
+block_set_queue (struct block *block, struct block_queue *q)
+{
+  ASSERT (block->queue == NULL);
+  ASSERT (block->forward == NULL);
+
+  lock_acquire (&q->lock);
+  block->queue = q;
+  list_push_back (&q->blocks, &block->queue_elem);
+  lock_release (&q->lock);
+}
+
+/* Has requests to BLOCK passed on to TO, offset by START
+   sectors, so that they share TO's queue.  Used for
+   partitions. */
+void
+block_set_forward (struct block *block, struct block *to,
+                   block_sector_t start)
+{
+  ASSERT (block->queue == NULL);
+  ASSERT (start + block->size >= start && start + block->size <= to->size);
+
+  block->forward = to;
+  block->forward_ofs = start;
+}
+
+/* Worker thread for queue Q_.  Serves its devices in turn, one
+   batch from each, so that a busy device cannot starve another
+   on the same channel. */
+static void
+queue_worker (void *q_)
+{
+  struct block_queue *q = q_;
+
+  for (;;)
+    {
+      struct block_request *batch[MERGE_REQUESTS];
+      struct block *block = NULL;
+      struct list_elem *e;
+      size_t cnt;
+
+      lock_acquire (&q->lock);
+      for (;;)
+        {
+          for (e = list_begin (&q->blocks); e != list_end (&q->blocks);
+               e = list_next (e))
+            {
+              block = list_entry (e, struct block, queue_elem);
+              if (block->depth > 0)
+                break;
+            }
+          if (e != list_end (&q->blocks))
+            break;
+          cond_wait (&q->work, &q->lock);
+        }
+      list_remove (&block->queue_elem);
+      list_push_back (&q->blocks, &block->queue_elem);
+      cnt = choose_batch (block, batch);
+      lock_release (&q->lock);
+
+      carry_out (block, batch, cnt);
+    }
 }
 
 /* Returns the number of sectors in BLOCK. */
@@ -160,10 +615,12 @@ block_type (struct block *block)
   return block->type;
 }
 
-/* Prints statistics for each block device used for a Pintos role. */
+/* Prints statistics for each block device used for a Pintos
+   role, then for each request queue. */
 void
 block_print_stats (void)
 {
+  struct list_elem *e;
   int i;
 
   for (i = 0; i < BLOCK_ROLE_CNT; i++)
@@ -176,6 +633,26 @@ block_print_stats (void)
                   block->read_cnt, block->write_cnt);
         }
     }
+
+  for (e = list_begin (&all_blocks); e != list_end (&all_blocks);
+       e = list_next (e))
+    {
+      struct block *block = list_entry (e, struct block, list_elem);
+      unsigned long long avg;
+      char prefix[48];
+
+      if (block->queue == NULL || block->request_cnt == 0)
+        continue;
+
+      /* Average depth in tenths. */
+      avg = block->depth_sum * 10 / block->request_cnt;
+      printf ("%s queue: %llu requests, %llu merged, "
+              "depth avg %llu.%llu max %zu\n",
+              block->name, block->request_cnt, block->merge_cnt,
+              avg / 10, avg % 10, block->max_depth);
+      snprintf (prefix, sizeof prefix, "%s latency (cycles)", block->name);
+      histogram_print (&block->latency, prefix);
+    }
 }
 
 /* Registers a new block device with the given NAME.  If
@@ -200,6 +677,19 @@ block_register (const char *name, enum block_type type,
   block->aux = aux;
   block->read_cnt = 0;
   block->write_cnt = 0;
+  block->forward = NULL;
+  block->forward_ofs = 0;
+  block->queue = NULL;
+  list_init (&block->sorted);
+  list_init (&block->fifo[0]);
+  list_init (&block->fifo[1]);
+  block->depth = 0;
+  block->next_sector = 0;
+  block->request_cnt = 0;
+  block->merge_cnt = 0;
+  block->depth_sum = 0;
+  block->max_depth = 0;
+  memset (&block->latency, 0, sizeof block->latency);
 
   printf ("%s: %'"PRDSNu" sectors (", block->name, block->size);
   print_human_readable_size ((uint64_t) block->size * BLOCK_SECTOR_SIZE);
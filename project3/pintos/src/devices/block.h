@@ -1,8 +1,10 @@
 #ifndef DEVICES_BLOCK_H
 #define DEVICES_BLOCK_H
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <inttypes.h>
+#include <list.h>
 
 /* Size of a block device sector in bytes.
    All IDE disks use this sector size, as do most USB and SCSI
@@ -53,22 +55,95 @@ struct block *block_next (struct block *);
 block_sector_t block_size (struct block *);
 void block_read (struct block *, block_sector_t, void *);
 void block_write (struct block *, block_sector_t, const void *);
+void block_read_multiple (struct block *, block_sector_t, size_t cnt, void *);
+void block_write_multiple (struct block *, block_sector_t, size_t cnt,
+                           const void *);
 const char *block_name (struct block *);
 enum block_type block_type (struct block *);
 
+/* Asynchronous requests.
+
+   A request transfers CNT consecutive sectors starting at SECTOR
+   between the device and BUFFER, which must be in kernel virtual
+   memory because another thread carries it out.  When the
+   transfer is done, DONE is called, if it is nonnull, and then
+   SEMA is up'd, if it is nonnull.  DONE runs in a kernel thread,
+   so it may sleep, but it should not take long, because no other
+   request on the same channel starts until it returns.
+
+   The request must stay allocated, and the submitter must not
+   touch it, until it is complete.  Requests outstanding at the
+   same time may be carried out in any order, so a submitter
+   that needs one to finish before another starts must wait for
+   it first. */
+struct block_request
+  {
+    /* Set by the submitter. */
+    block_sector_t sector;              /* First sector. */
+    size_t cnt;                         /* Number of sectors. */
+    void *buffer;                       /* CNT * BLOCK_SECTOR_SIZE bytes. */
+    bool write;                         /* Write if true, else read. */
+    void (*done) (struct block_request *); /* Completion callback. */
+    struct semaphore *sema;             /* Completion semaphore. */
+    void *aux;                          /* For the submitter's use. */
+
+    /* Owned by the block layer. */
+    struct block *block;                /* Device submitted to. */
+    block_sector_t dev_sector;          /* SECTOR on the queued device. */
+    struct list_elem sorted_elem;       /* Element in device's sorted list. */
+    struct list_elem fifo_elem;         /* Element in device's FIFO. */
+    int64_t deadline;                   /* Dispatch by this timer tick. */
+    uint64_t submit_tsc;                /* TSC at submission. */
+  };
+
+void block_submit (struct block *, struct block_request *);
+
 /* Statistics. */
 void block_print_stats (void);
 
 /* Lower-level interface to block device drivers. */
 
+/* One buffer in a vectored transfer: CNT sectors at BUFFER. */
+struct block_iovec
+  {
+    void *buffer;
+    size_t cnt;
+  };
+
 struct block_operations
   {
     void (*read) (void *aux, block_sector_t, void *buffer);
     void (*write) (void *aux, block_sector_t, const void *buffer);
+
+    /* Optional.  Transfer CNT consecutive sectors.  If null, the
+       block layer calls read or write once per sector instead. */
+    void (*read_multiple) (void *aux, block_sector_t, size_t cnt,
+                           void *buffer);
+    void (*write_multiple) (void *aux, block_sector_t, size_t cnt,
+                            const void *buffer);
+
+    /* Optional.  Transfer the IOV_CNT buffers in IOV, in order, to
+       or from consecutive sectors, as a single operation if
+       possible.  Used for merged requests. */
+    void (*transfer) (void *aux, block_sector_t,
+                      const struct block_iovec *iov, size_t iov_cnt,
+                      bool write);
   };
 
 struct block *block_register (const char *name, enum block_type,
                               const char *extra_info, block_sector_t size,
                               const struct block_operations *, void *aux);
 
+/* Request queues.  A driver that attaches a queue to a device
+   has all requests to that device carried out, in an order
+   chosen to reduce seeking, by the queue's worker thread.
+   Devices on the same queue are served one request at a time,
+   so a driver should use one queue per controller channel.
+   Devices without a queue carry out requests in the submitting
+   thread. */
+struct block_queue *block_queue_create (const char *name);
+void block_set_queue (struct block *, struct block_queue *);
+void block_set_forward (struct block *, struct block *to,
+                        block_sector_t start);
+
 #endif /* devices/block.h */
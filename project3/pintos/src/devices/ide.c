@@ -3,15 +3,26 @@
 #include <debug.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 #include "devices/block.h"
 #include "devices/partition.h"
+#include "devices/pci.h"
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
+#include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/vaddr.h"
 
 /* The code in this file is an interface to an ATA (IDE)
-   controller.  It attempts to comply to [ATA-3]. */
+   controller.  It attempts to comply to [ATA-3].
+
+   Data moves by bus-master DMA if the controller is a PCI IDE
+   controller that supports it, as the PIIX that QEMU and Bochs
+   emulate does, and by programmed I/O (PIO) otherwise.  DMA
+   needs the physical address of the buffer, so transfers to or
+   from buffers that are not in kernel virtual memory always
+   use PIO. */
 
 /* ATA command block port addresses. */
 #define reg_data(CHANNEL) ((CHANNEL)->reg_base + 0)     /* Data. */
@@ -34,6 +45,7 @@
 #define STA_BSY 0x80            /* Busy. */
 #define STA_DRDY 0x40           /* Device Ready. */
 #define STA_DRQ 0x08            /* Data Request. */
+#define STA_ERR 0x01            /* Error. */
 
 /* Control Register bits. */
 #define CTL_SRST 0x04           /* Software Reset. */
@@ -49,6 +61,42 @@
 #define CMD_IDENTIFY_DEVICE 0xec        /* IDENTIFY DEVICE. */
 #define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR with retries. */
+#define CMD_READ_MULTIPLE 0xc4          /* READ MULTIPLE. */
+#define CMD_WRITE_MULTIPLE 0xc5         /* WRITE MULTIPLE. */
+#define CMD_SET_MULTIPLE_MODE 0xc6      /* SET MULTIPLE MODE. */
+#define CMD_READ_DMA 0xc8               /* READ DMA. */
+#define CMD_WRITE_DMA 0xca              /* WRITE DMA. */
+
+/* Bus master IDE registers, relative to the channel's base
+   address.  Refer to the Programming Interface for Bus Master
+   IDE Controller, revision 1.0. */
+#define reg_bm_command(CHANNEL) ((CHANNEL)->bm_base + 0) /* Command. */
+#define reg_bm_status(CHANNEL) ((CHANNEL)->bm_base + 2)  /* Status. */
+#define reg_bm_prdt(CHANNEL) ((CHANNEL)->bm_base + 4)    /* PRD table. */
+
+/* Bus master command register bits. */
+#define BM_CMD_START 0x01       /* Start transfer. */
+#define BM_CMD_READ 0x08        /* 1=write to memory (disk read). */
+
+/* Bus master status register bits. */
+#define BM_STA_ERR 0x02         /* Error (write 1 to clear). */
+#define BM_STA_IRQ 0x04         /* Interrupt (write 1 to clear). */
+
+/* Physical region descriptor.  A channel's PRD table lists the
+   physical memory regions that make up a DMA buffer.  No region
+   may cross a 64 kB boundary. */
+struct prd
+  {
+    uint32_t addr;              /* Physical address. */
+    uint16_t size;              /* Size in bytes, 0 means 64 kB. */
+    uint16_t flags;             /* PRD_EOT on the last entry. */
+  };
+#define PRD_EOT 0x8000          /* End of table. */
+#define PRD_CNT (PGSIZE / sizeof (struct prd))
+
+/* Most sectors a single READ or WRITE command can transfer.
+   A sector count register value of 0 means this many. */
+#define MAX_CMD_SECTORS 256
 
 /* An ATA device. */
 struct ata_disk
@@ -57,6 +105,10 @@ struct ata_disk
     struct channel *channel;    /* Channel that disk is attached to. */
     int dev_no;                 /* Device 0 or 1 for master or slave. */
     bool is_ata;                /* Is device an ATA disk? */
+    int multiple;               /* Sectors per interrupt for READ/WRITE
+                                   MULTIPLE, or 1 to use READ/WRITE
+                                   SECTOR instead. */
+    bool dma;                   /* Does the disk support DMA? */
   };
 
 /* An ATA channel (aka controller).
@@ -71,6 +123,14 @@ struct channel
     bool expecting_interrupt;   /* True if an interrupt is expected, false if
                                    any interrupt would be spurious. */
     struct semaphore completion_wait;   /* Up'd by interrupt handler. */
+    uint8_t status;             /* Status read by interrupt handler. */
+
+    uint16_t bm_base;           /* Bus master base port, 0 for PIO only. */
+    struct prd *prdt;           /* PRD table, one page. */
+    bool dma_active;            /* True while a DMA transfer runs. */
+    uint8_t bm_status;          /* Bus master status at completion. */
+
+    struct block_queue *queue;  /* Request queue, once a disk is found. */
 
     struct ata_disk devices[2];     /* The devices on this channel. */
   };
@@ -81,14 +141,26 @@ static struct channel channels[CHANNEL_CNT];
 
 static struct block_operations ide_operations;
 
+/* See ide.h. */
+bool ide_use_dma = true;
+
 static void reset_channel (struct channel *);
 static bool check_device_type (struct ata_disk *);
 static void identify_ata_device (struct ata_disk *);
+static void set_multiple_mode (struct ata_disk *, int max);
+static uint16_t find_bus_master (void);
+
+struct iov_cursor;
+static void pio_transfer (struct ata_disk *, block_sector_t, size_t cnt,
+                          struct iov_cursor *, bool write);
+static bool dma_transfer (struct ata_disk *, block_sector_t, size_t cnt,
+                          struct iov_cursor *, bool write);
+static bool build_prdt (struct channel *, struct iov_cursor *, size_t cnt);
 
-static void select_sector (struct ata_disk *, block_sector_t);
+static void select_sector (struct ata_disk *, block_sector_t, size_t cnt);
 static void issue_pio_command (struct channel *, uint8_t command);
-static void input_sector (struct channel *, void *);
-static void output_sector (struct channel *, const void *);
+static void input_sectors (struct channel *, void *, size_t cnt);
+static void output_sectors (struct channel *, const void *, size_t cnt);
 
 static void wait_until_idle (const struct ata_disk *);
 static bool wait_while_busy (const struct ata_disk *);
@@ -102,6 +174,7 @@ void
 ide_init (void) 
 {
   size_t chan_no;
+  uint16_t bm_base = ide_use_dma ? find_bus_master () : 0;
 
   for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++)
     {
@@ -124,8 +197,22 @@ ide_init (void)
           NOT_REACHED ();
         }
       lock_init (&c->lock);
+      lock_profile (&c->lock, c->name);
       c->expecting_interrupt = false;
       sema_init (&c->completion_wait, 0);
+      c->queue = NULL;
+
+      /* Set up DMA.  The second channel's bus master registers
+         follow the first's. */
+      c->bm_base = 0;
+      c->prdt = NULL;
+      c->dma_active = false;
+      if (bm_base != 0)
+        {
+          c->prdt = palloc_get_page (0);
+          if (c->prdt != NULL)
+            c->bm_base = bm_base + chan_no * 8;
+        }
  
       /* Initialize devices. */
       for (dev_no = 0; dev_no < 2; dev_no++)
@@ -136,6 +223,8 @@ ide_init (void)
           d->channel = c;
           d->dev_no = dev_no;
           d->is_ata = false;
+          d->multiple = 1;
+          d->dma = false;
         }
 
       /* Register interrupt handler. */
@@ -279,7 +368,7 @@ identify_ata_device (struct ata_disk *d)
       d->is_ata = false;
       return;
     }
-  input_sector (c, id);
+  input_sectors (c, id, 1);
 
   /* Calculate capacity.
      Read model name and serial number. */
@@ -303,12 +392,67 @@ identify_ata_device (struct ata_disk *d)
       return;
     }
 
+  /* Let READ/WRITE MULTIPLE move as many sectors per interrupt
+     as the disk allows.  Word 47 holds that maximum. */
+  set_multiple_mode (d, (uint8_t) id[47 * 2]);
+
+  /* Bit 8 of word 49 says whether the disk can do DMA. */
+  d->dma = c->bm_base != 0 && (id[49 * 2 + 1] & 0x01) != 0;
+  if (d->dma)
+    strlcat (extra_info, ", DMA", sizeof extra_info);
+
   /* Register. */
   block = block_register (d->name, BLOCK_RAW, extra_info, capacity,
                           &ide_operations, d);
+  if (c->queue == NULL)
+    c->queue = block_queue_create (c->name);
+  block_set_queue (block, c->queue);
   partition_scan (block);
 }
 
+/* Tries to set disk D's DRQ block size to MAX sectors, or the
+   largest power of 2 below it, for use with READ/WRITE
+   MULTIPLE.  On failure D goes on using single-sector DRQ
+   blocks. */
+static void
+set_multiple_mode (struct ata_disk *d, int max) 
+{
+  struct channel *c = d->channel;
+  int cnt;
+
+  for (cnt = 1; cnt * 2 <= max; cnt *= 2)
+    continue;
+  if (cnt == 1)
+    return;
+
+  select_device_wait (d);
+  outb (reg_nsect (c), cnt);
+  issue_pio_command (c, CMD_SET_MULTIPLE_MODE);
+  sema_down (&c->completion_wait);
+  wait_while_busy (d);
+  if ((inb (reg_alt_status (c)) & STA_ERR) == 0)
+    d->multiple = cnt;
+}
+
+/* Looks for a PCI IDE controller that can act as a bus master
+   for the legacy channels, and enables bus mastering on it.
+   Returns its bus master base port, or 0 if there is none. */
+static uint16_t
+find_bus_master (void) 
+{
+  struct pci_dev pci;
+  uint16_t base;
+
+  /* Class 1, subclass 1 is an IDE controller.  Bit 7 of the
+     programming interface says it supports bus mastering. */
+  if (!pci_find_class (0x01, 0x01, &pci) || !(pci.prog_if & 0x80))
+    return 0;
+  base = pci_io_bar (&pci, 4);
+  if (base != 0)
+    pci_enable_bus_master (&pci);
+  return base;
+}
+
 /* Translates STRING, which consists of SIZE bytes in a funky
    format, into a null-terminated string in-place.  Drops
    trailing whitespace and null bytes.  Returns STRING.  */
@@ -337,63 +481,280 @@ descramble_ata_string (char *string, int size)
   return string;
 }
 
-/* Reads sector SEC_NO from disk D into BUFFER, which must have
-   room for BLOCK_SECTOR_SIZE bytes.
+/* A position within a vector of buffers, advanced one sector at
+   a time by next_sector(). */
+struct iov_cursor
+  {
+    const struct block_iovec *iov;      /* Current buffer. */
+    size_t ofs;                         /* Sectors already used in IOV. */
+  };
+
+/* Returns the buffer for the next sector at CUR and advances CUR
+   past it. */
+static uint8_t *
+next_sector (struct iov_cursor *cur) 
+{
+  uint8_t *p;
+
+  while (cur->ofs >= cur->iov->cnt)
+    {
+      cur->iov++;
+      cur->ofs = 0;
+    }
+  p = (uint8_t *) cur->iov->buffer + cur->ofs * BLOCK_SECTOR_SIZE;
+  cur->ofs++;
+  return p;
+}
+
+/* Transfers the IOV_CNT buffers in IOV, in order, between disk D
+   and the consecutive sectors starting at SEC_NO: reads from the
+   disk if WRITE is false, writes to it if WRITE is true.  Each
+   command moves up to MAX_CMD_SECTORS sectors, by DMA if
+   possible and otherwise by PIO.  Returns after the disk has
+   completed the transfer.
    Internally synchronizes accesses to disks, so external
    per-disk locking is unneeded. */
 static void
-ide_read (void *d_, block_sector_t sec_no, void *buffer)
+ide_transfer (void *d_, block_sector_t sec_no,
+              const struct block_iovec *iov, size_t iov_cnt, bool write)
 {
   struct ata_disk *d = d_;
   struct channel *c = d->channel;
+  struct iov_cursor cur;
+  size_t cnt = 0;
+  size_t i;
+
+  for (i = 0; i < iov_cnt; i++)
+    cnt += iov[i].cnt;
+  cur.iov = iov;
+  cur.ofs = 0;
+
   lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_READ_SECTOR_RETRY);
-  sema_down (&c->completion_wait);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
-  input_sector (c, buffer);
+  while (cnt > 0)
+    {
+      size_t cmd_cnt = cnt < MAX_CMD_SECTORS ? cnt : MAX_CMD_SECTORS;
+
+      if (!dma_transfer (d, sec_no, cmd_cnt, &cur, write))
+        pio_transfer (d, sec_no, cmd_cnt, &cur, write);
+      sec_no += cmd_cnt;
+      cnt -= cmd_cnt;
+    }
   lock_release (&c->lock);
 }
 
+/* Reads CNT sectors starting at SEC_NO from disk D into BUFFER,
+   which must have room for CNT * BLOCK_SECTOR_SIZE bytes. */
+static void
+ide_read_multiple (void *d_, block_sector_t sec_no, size_t cnt, void *buffer)
+{
+  struct block_iovec iov;
+
+  iov.buffer = buffer;
+  iov.cnt = cnt;
+  ide_transfer (d_, sec_no, &iov, 1, false);
+}
+
+/* Writes CNT sectors starting at SEC_NO to disk D from BUFFER,
+   which must contain CNT * BLOCK_SECTOR_SIZE bytes. */
+static void
+ide_write_multiple (void *d_, block_sector_t sec_no, size_t cnt,
+                    const void *buffer)
+{
+  struct block_iovec iov;
+
+  iov.buffer = (void *) buffer;
+  iov.cnt = cnt;
+  ide_transfer (d_, sec_no, &iov, 1, true);
+}
+
+/* Reads sector SEC_NO from disk D into BUFFER, which must have
+   room for BLOCK_SECTOR_SIZE bytes. */
+static void
+ide_read (void *d_, block_sector_t sec_no, void *buffer)
+{
+  ide_read_multiple (d_, sec_no, 1, buffer);
+}
+
 /* Write sector SEC_NO to disk D from BUFFER, which must contain
-   BLOCK_SECTOR_SIZE bytes.  Returns after the disk has
-   acknowledged receiving the data.
-   Internally synchronizes accesses to disks, so external
-   per-disk locking is unneeded. */
+   BLOCK_SECTOR_SIZE bytes. */
 static void
 ide_write (void *d_, block_sector_t sec_no, const void *buffer)
 {
-  struct ata_disk *d = d_;
-  struct channel *c = d->channel;
-  lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
-  output_sector (c, buffer);
-  sema_down (&c->completion_wait);
-  lock_release (&c->lock);
+  ide_write_multiple (d_, sec_no, 1, buffer);
 }
 
 static struct block_operations ide_operations =
   {
     ide_read,
-    ide_write
+    ide_write,
+    ide_read_multiple,
+    ide_write_multiple,
+    ide_transfer
   };
 
+/* Transfers CNT sectors, at most MAX_CMD_SECTORS, starting at
+   SEC_NO between disk D and the buffers at *CUR by PIO, reading
+   from the disk if WRITE is false and writing to it otherwise,
+   and advances *CUR past them.  The disk interrupts once per
+   D->multiple sectors.  D's channel must be locked. */
+static void
+pio_transfer (struct ata_disk *d, block_sector_t sec_no, size_t cnt,
+              struct iov_cursor *cur, bool write) 
+{
+  struct channel *c = d->channel;
+  size_t done, blk_cnt, i;
+
+  select_sector (d, sec_no, cnt);
+  if (!write)
+    issue_pio_command (c, (d->multiple > 1
+                           ? CMD_READ_MULTIPLE
+                           : CMD_READ_SECTOR_RETRY));
+  else
+    issue_pio_command (c, (d->multiple > 1
+                           ? CMD_WRITE_MULTIPLE
+                           : CMD_WRITE_SECTOR_RETRY));
+
+  for (done = 0; done < cnt; done += blk_cnt)
+    {
+      blk_cnt = cnt - done;
+      if (blk_cnt > (size_t) d->multiple)
+        blk_cnt = d->multiple;
+
+      if (!write)
+        {
+          /* The disk interrupts when a block is ready to read. */
+          sema_down (&c->completion_wait);
+          if (!wait_while_busy (d))
+            PANIC ("%s: disk read failed, sector=%"PRDSNu,
+                   d->name, sec_no + done);
+          for (i = 0; i < blk_cnt; i++)
+            input_sectors (c, next_sector (cur), 1);
+        }
+      else
+        {
+          /* The disk interrupts when it has taken a block. */
+          if (!wait_while_busy (d))
+            PANIC ("%s: disk write failed, sector=%"PRDSNu,
+                   d->name, sec_no + done);
+          for (i = 0; i < blk_cnt; i++)
+            output_sectors (c, next_sector (cur), 1);
+          sema_down (&c->completion_wait);
+        }
+    }
+}
+
+/* Transfers CNT sectors, at most MAX_CMD_SECTORS, starting at
+   SEC_NO between disk D and the buffers at *CUR by DMA, reading
+   from the disk if WRITE is false and writing to it otherwise,
+   and advances *CUR past them.  Returns false without doing
+   anything if D or the buffers cannot be used for DMA, in which
+   case the caller should use PIO.  D's channel must be
+   locked. */
+static bool
+dma_transfer (struct ata_disk *d, block_sector_t sec_no, size_t cnt,
+              struct iov_cursor *cur, bool write) 
+{
+  struct channel *c = d->channel;
+  uint8_t command = write ? 0 : BM_CMD_READ;
+
+  if (!d->dma || !build_prdt (c, cur, cnt))
+    return false;
+
+  /* Point the bus master at the PRD table, set the direction,
+     and clear any stale interrupt and error bits. */
+  outl (reg_bm_prdt (c), vtop (c->prdt));
+  outb (reg_bm_command (c), command);
+  outb (reg_bm_status (c),
+        inb (reg_bm_status (c)) | BM_STA_IRQ | BM_STA_ERR);
+
+  /* Issue the command, then start the bus master.  The
+     interrupt handler stops it again. */
+  select_sector (d, sec_no, cnt);
+  c->dma_active = true;
+  issue_pio_command (c, write ? CMD_WRITE_DMA : CMD_READ_DMA);
+  outb (reg_bm_command (c), command | BM_CMD_START);
+  sema_down (&c->completion_wait);
+
+  if ((c->bm_status & BM_STA_ERR) || (c->status & STA_ERR))
+    PANIC ("%s: disk DMA %s failed, sector=%"PRDSNu,
+           d->name, write ? "write" : "read", sec_no);
+  return true;
+}
+
+/* Fills in channel C's PRD table to describe the next CNT
+   sectors of buffers at *CUR, and advances *CUR past them.
+   Returns false, leaving *CUR unchanged, if that cannot be done
+   because a buffer is not in kernel virtual memory or is
+   misaligned. */
+static bool
+build_prdt (struct channel *c, struct iov_cursor *cur, size_t cnt) 
+{
+  struct iov_cursor next = *cur;
+  size_t prd_cnt = 0;
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    {
+      uint8_t *p = next_sector (&next);
+      size_t left = BLOCK_SECTOR_SIZE;
+
+      if (!is_kernel_vaddr (p) || (uintptr_t) p % 2 != 0)
+        return false;
+
+      /* Kernel virtual memory maps physical memory linearly, so a
+         sector is physically contiguous, but it may still cross a
+         64 kB boundary. */
+      while (left > 0)
+        {
+          uint32_t addr = vtop (p);
+          size_t chunk = 65536 - addr % 65536;
+          struct prd *last = prd_cnt > 0 ? &c->prdt[prd_cnt - 1] : NULL;
+          size_t last_size = (last == NULL ? 0
+                              : last->size == 0 ? 65536
+                              : last->size);
+
+          if (chunk > left)
+            chunk = left;
+
+          /* Extend the last region if this piece follows it in
+             physical memory without starting a new 64 kB block.
+             Otherwise, start a new region. */
+          if (last != NULL && last->addr + last_size == addr
+              && addr % 65536 != 0)
+            last->size = last_size + chunk;
+          else
+            {
+              if (prd_cnt >= PRD_CNT)
+                return false;
+              c->prdt[prd_cnt].addr = addr;
+              c->prdt[prd_cnt].size = chunk;
+              c->prdt[prd_cnt].flags = 0;
+              prd_cnt++;
+            }
+
+          p += chunk;
+          left -= chunk;
+        }
+    }
+  c->prdt[prd_cnt - 1].flags = PRD_EOT;
+  *cur = next;
+  return true;
+}
+
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
+   writes SEC_NO and CNT, which must be between 1 and
+   MAX_CMD_SECTORS, to the disk's sector selection registers.
+   (We use LBA mode.) */
 static void
-select_sector (struct ata_disk *d, block_sector_t sec_no)
+select_sector (struct ata_disk *d, block_sector_t sec_no, size_t cnt)
 {
   struct channel *c = d->channel;
 
-  ASSERT (sec_no < (1UL << 28));
+  ASSERT (cnt >= 1 && cnt <= MAX_CMD_SECTORS);
+  ASSERT (sec_no + cnt <= (1UL << 28));
   
   select_device_wait (d);
-  outb (reg_nsect (c), 1);
+  outb (reg_nsect (c), cnt == MAX_CMD_SECTORS ? 0 : cnt);
   outb (reg_lbal (c), sec_no);
   outb (reg_lbam (c), sec_no >> 8);
   outb (reg_lbah (c), (sec_no >> 16));
@@ -414,20 +775,22 @@ issue_pio_command (struct channel *c, uint8_t command)
   outb (reg_command (c), command);
 }
 
-/* Reads a sector from channel C's data register in PIO mode into
-   SECTOR, which must have room for BLOCK_SECTOR_SIZE bytes. */
+/* Reads CNT sectors from channel C's data register in PIO mode
+   into SECTORS, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes. */
 static void
-input_sector (struct channel *c, void *sector) 
+input_sectors (struct channel *c, void *sectors, size_t cnt) 
 {
-  insw (reg_data (c), sector, BLOCK_SECTOR_SIZE / 2);
+  insw (reg_data (c), sectors, cnt * BLOCK_SECTOR_SIZE / 2);
 }
 
-/* Writes SECTOR to channel C's data register in PIO mode.
-   SECTOR must contain BLOCK_SECTOR_SIZE bytes. */
+/* Writes CNT sectors from SECTORS to channel C's data register
+   in PIO mode.  SECTORS must contain CNT * BLOCK_SECTOR_SIZE
+   bytes. */
 static void
-output_sector (struct channel *c, const void *sector) 
+output_sectors (struct channel *c, const void *sectors, size_t cnt) 
 {
-  outsw (reg_data (c), sector, BLOCK_SECTOR_SIZE / 2);
+  outsw (reg_data (c), sectors, cnt * BLOCK_SECTOR_SIZE / 2);
 }
 
 /* Low-level ATA primitives. */
@@ -513,7 +876,15 @@ interrupt_handler (struct intr_frame *f)
       {
         if (c->expecting_interrupt) 
           {
-            inb (reg_status (c));               /* Acknowledge interrupt. */
+            if (c->dma_active)
+              {
+                /* Stop the bus master and clear its interrupt. */
+                c->bm_status = inb (reg_bm_status (c));
+                outb (reg_bm_command (c), 0);
+                outb (reg_bm_status (c), c->bm_status);
+                c->dma_active = false;
+              }
+            c->status = inb (reg_status (c));   /* Acknowledge interrupt. */
             sema_up (&c->completion_wait);      /* Wake up waiter. */
           }
         else
@@ -1,6 +1,13 @@
 #ifndef DEVICES_IDE_H
 #define DEVICES_IDE_H
 
+#include <stdbool.h>
+
+/* If true (default), use bus-master DMA when the controller
+   supports it.  If false, always use PIO.  Controlled by kernel
+   command-line option "-nodma". */
+extern bool ide_use_dma;
+
 void ide_init (void);
 
 #endif /* devices/ide.h */
@@ -7,6 +7,7 @@
 #include "devices/shutdown.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/synch.h"
 
 /* Keyboard data register port. */
 #define DATA_REG 0x60
@@ -137,6 +138,13 @@ keyboard_interrupt (struct intr_frame *args UNUSED)
           if (c == 0177 && ctrl && alt)
             shutdown_reboot ();
 
+          /* Dump the lock profile if Ctrl+Alt+L pressed. */
+          if (c == 'L' && ctrl && alt)
+            {
+              lock_print_stats ();
+              return;
+            }
+
           /* Handle Ctrl, Shift.
              Note that Ctrl overrides Shift. */
           if (ctrl && c >= 0x40 && c < 0x60) 
@@ -1,4 +1,5 @@
 #include "devices/partition.h"
+#include <debug.h>
 #include <packed.h>
 #include <stdlib.h>
 #include <string.h>
@@ -6,13 +7,6 @@
 #include "devices/block.h"
 #include "threads/malloc.h"
 
-/* A partition of a block device. */
-struct partition
-  {
-    struct block *block;                /* Underlying block device. */
-    block_sector_t start;               /* First sector within device. */
-  };
-
 static struct block_operations partition_operations;
 
 static void read_partition_table (struct block *, block_sector_t sector,
@@ -168,20 +162,15 @@ found_partition (struct block *block, uint8_t part_type,
                               : part_type == 0x22 ? BLOCK_SCRATCH
                               : part_type == 0x23 ? BLOCK_SWAP
                               : BLOCK_FOREIGN);
-      struct partition *p;
       char extra_info[128];
       char name[16];
 
-      p = malloc (sizeof *p);
-      if (p == NULL)
-        PANIC ("Failed to allocate memory for partition descriptor");
-      p->block = block;
-      p->start = start;
-
       snprintf (name, sizeof name, "%s%d", block_name (block), part_nr);
       snprintf (extra_info, sizeof extra_info, "%s (%02x)",
                 partition_type_name (part_type), part_type);
-      block_register (name, type, extra_info, size, &partition_operations, p);
+      block_set_forward (block_register (name, type, extra_info, size,
+                                         &partition_operations, NULL),
+                         block, start);
     }
 }
 
@@ -298,27 +287,28 @@ partition_type_name (uint8_t type)
   return type_names[type] != NULL ? type_names[type] : "Unknown";
 }
 
-/* Reads sector SECTOR from partition P into BUFFER, which must
-   have room for BLOCK_SECTOR_SIZE bytes. */
+/* Partitions forward every request to their underlying device
+   (see block_set_forward()), so the block layer never calls
+   these. */
 static void
-partition_read (void *p_, block_sector_t sector, void *buffer)
+partition_read (void *aux UNUSED, block_sector_t sector UNUSED,
+                void *buffer UNUSED)
 {
-  struct partition *p = p_;
-  block_read (p->block, p->start + sector, buffer);
+  NOT_REACHED ();
 }
 
-/* Write sector SECTOR to partition P from BUFFER, which must
-   contain BLOCK_SECTOR_SIZE bytes.  Returns after the block has
-   acknowledged receiving the data. */
 static void
-partition_write (void *p_, block_sector_t sector, const void *buffer)
+partition_write (void *aux UNUSED, block_sector_t sector UNUSED,
+                 const void *buffer UNUSED)
 {
-  struct partition *p = p_;
-  block_write (p->block, p->start + sector, buffer);
+  NOT_REACHED ();
 }
 
 static struct block_operations partition_operations =
   {
     partition_read,
-    partition_write
+    partition_write,
+    NULL,
+    NULL,
+    NULL
   };
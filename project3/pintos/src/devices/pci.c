@@ -0,0 +1,183 @@
+#include "devices/pci.h"
+#include <debug.h>
+#include "threads/interrupt.h"
+#include "threads/io.h"
+
+/* PCI configuration space access, using configuration
+   mechanism #1, which every PC chipset since the original PCI
+   ones supports.  Refer to the PCI Local Bus Specification,
+   section 3.2.2.3.2 "Software Generation of Configuration
+   Transactions".
+
+   Pintos does not enumerate the bus at boot.  Drivers that want
+   a PCI device look for it with pci_find_class() or
+   pci_find_device(), which scan bus 0, and then program it
+   through the functions here. */
+
+#define CONFIG_ADDRESS 0xcf8    /* Configuration address port. */
+#define CONFIG_DATA 0xcfc       /* Configuration data port. */
+
+/* Number of device slots on a bus and functions per device. */
+#define DEV_CNT 32
+#define FUNC_CNT 8
+
+/* Returns the CONFIG_ADDRESS value that selects register REG,
+   which must be a multiple of 4, of BUS:DEV.FUNC. */
+static uint32_t
+config_address (int bus, int dev, int func, int reg) 
+{
+  ASSERT (reg % 4 == 0 && reg < 256);
+  return 0x80000000 | (bus << 16) | (dev << 11) | (func << 8) | reg;
+}
+
+/* Reads 32-bit register REG of BUS:DEV.FUNC.  The address and
+   data ports must be used as a pair, so interrupts are turned off
+   in between. */
+static uint32_t
+read_config (int bus, int dev, int func, int reg) 
+{
+  enum intr_level old_level = intr_disable ();
+  uint32_t value;
+
+  outl (CONFIG_ADDRESS, config_address (bus, dev, func, reg));
+  value = inl (CONFIG_DATA);
+  intr_set_level (old_level);
+
+  return value;
+}
+
+/* Reads 32-bit configuration register REG, which must be a
+   multiple of 4, of function D. */
+uint32_t
+pci_read_config (const struct pci_dev *d, int reg) 
+{
+  return read_config (d->bus, d->dev, d->func, reg);
+}
+
+/* Writes VALUE to 32-bit configuration register REG, which must
+   be a multiple of 4, of function D. */
+void
+pci_write_config (const struct pci_dev *d, int reg, uint32_t value) 
+{
+  enum intr_level old_level = intr_disable ();
+  outl (CONFIG_ADDRESS, config_address (d->bus, d->dev, d->func, reg));
+  outl (CONFIG_DATA, value);
+  intr_set_level (old_level);
+}
+
+/* Scans bus 0 for the functions for which MATCH returns true,
+   given the function's ID and class registers and AUX.  If there
+   are more than IDX of them, stores the one with index IDX
+   (counting from 0) in *D and returns true. */
+static bool
+find (bool (*match) (uint32_t id, uint32_t class, const void *aux),
+      const void *aux, int idx, struct pci_dev *d) 
+{
+  int dev, func;
+
+  for (dev = 0; dev < DEV_CNT; dev++)
+    for (func = 0; func < FUNC_CNT; func++)
+      {
+        uint32_t id = read_config (0, dev, func, PCI_REG_ID);
+        uint32_t class;
+
+        if ((id & 0xffff) == 0xffff)
+          {
+            /* No such function.  If function 0 is absent, so is
+               the whole device. */
+            if (func == 0)
+              break;
+            continue;
+          }
+
+        class = read_config (0, dev, func, PCI_REG_CLASS);
+        if (match (id, class, aux) && idx-- == 0)
+          {
+            d->bus = 0;
+            d->dev = dev;
+            d->func = func;
+            d->vendor = id & 0xffff;
+            d->device = id >> 16;
+            d->class = class >> 24;
+            d->subclass = class >> 16;
+            d->prog_if = class >> 8;
+            d->irq = read_config (0, dev, func, PCI_REG_INTR) & 0xff;
+            return true;
+          }
+
+        /* Bit 7 of the header type says whether the device has
+           more than one function. */
+        if (func == 0 && !(read_config (0, dev, 0, 0x0c) & 0x00800000))
+          break;
+      }
+  return false;
+}
+
+/* find() callback that matches the class and subclass in AUX. */
+static bool
+match_class (uint32_t id UNUSED, uint32_t class, const void *aux) 
+{
+  const uint8_t *want = aux;
+  return (class >> 24) == want[0] && ((class >> 16) & 0xff) == want[1];
+}
+
+/* find() callback that matches the vendor and device in AUX. */
+static bool
+match_device (uint32_t id, uint32_t class UNUSED, const void *aux) 
+{
+  const uint16_t *want = aux;
+  return (id & 0xffff) == want[0] && (id >> 16) == want[1];
+}
+
+/* Finds the first function on bus 0 with the given CLASS and
+   SUBCLASS.  Returns true and stores it in *D if there is one,
+   otherwise returns false. */
+bool
+pci_find_class (uint8_t class, uint8_t subclass, struct pci_dev *d) 
+{
+  uint8_t want[2];
+
+  want[0] = class;
+  want[1] = subclass;
+  return find (match_class, want, 0, d);
+}
+
+/* Finds function number IDX, counting from 0 in bus order, among
+   those on bus 0 with the given VENDOR and DEVICE IDs.  Returns
+   true and stores it in *D if there is one, otherwise returns
+   false. */
+bool
+pci_find_device (uint16_t vendor, uint16_t device, int idx,
+                 struct pci_dev *d) 
+{
+  uint16_t want[2];
+
+  want[0] = vendor;
+  want[1] = device;
+  return find (match_device, want, idx, d);
+}
+
+/* Returns the I/O port base in base address register BAR (0 to
+   5) of function D, or 0 if that BAR is unused or maps memory
+   instead of I/O ports. */
+uint16_t
+pci_io_bar (const struct pci_dev *d, int bar) 
+{
+  uint32_t value;
+
+  ASSERT (bar >= 0 && bar < 6);
+  value = pci_read_config (d, PCI_REG_BAR0 + bar * 4);
+  return value & 1 ? value & 0xfffc : 0;
+}
+
+/* Lets function D respond to I/O accesses and act as a bus
+   master, as needed for DMA. */
+void
+pci_enable_bus_master (const struct pci_dev *d) 
+{
+  /* The upper half of the register is the status register, in
+     which writing 1 clears a bit, so write zeros there. */
+  uint32_t command = pci_read_config (d, PCI_REG_COMMAND) & 0xffff;
+  pci_write_config (d, PCI_REG_COMMAND,
+                    command | PCI_CMD_IO | PCI_CMD_MASTER);
+}
@@ -0,0 +1,44 @@
+#ifndef DEVICES_PCI_H
+#define DEVICES_PCI_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* A PCI function, as found by pci_find_class() or
+   pci_find_device(). */
+struct pci_dev
+  {
+    uint8_t bus;                /* Bus number. */
+    uint8_t dev;                /* Device number on bus. */
+    uint8_t func;               /* Function number in device. */
+    uint16_t vendor;            /* Vendor ID. */
+    uint16_t device;            /* Device ID. */
+    uint8_t class;              /* Base class code. */
+    uint8_t subclass;           /* Subclass code. */
+    uint8_t prog_if;            /* Programming interface. */
+    uint8_t irq;                /* Interrupt line (legacy IRQ number). */
+  };
+
+/* Configuration space registers common to all functions. */
+#define PCI_REG_ID 0x00         /* Device ID (31:16), vendor ID (15:0). */
+#define PCI_REG_COMMAND 0x04    /* Command (15:0). */
+#define PCI_REG_CLASS 0x08      /* Class, subclass, prog. i/f, revision. */
+#define PCI_REG_BAR0 0x10       /* First base address register. */
+#define PCI_REG_INTR 0x3c       /* Interrupt line (7:0). */
+
+/* Command register bits. */
+#define PCI_CMD_IO 0x0001       /* Respond to I/O space accesses. */
+#define PCI_CMD_MEMORY 0x0002   /* Respond to memory space accesses. */
+#define PCI_CMD_MASTER 0x0004   /* Allow bus mastering. */
+
+uint32_t pci_read_config (const struct pci_dev *, int reg);
+void pci_write_config (const struct pci_dev *, int reg, uint32_t);
+
+bool pci_find_class (uint8_t class, uint8_t subclass, struct pci_dev *);
+bool pci_find_device (uint16_t vendor, uint16_t device, int idx,
+                      struct pci_dev *);
+
+uint16_t pci_io_bar (const struct pci_dev *, int bar);
+void pci_enable_bus_master (const struct pci_dev *);
+
+#endif /* devices/pci.h */
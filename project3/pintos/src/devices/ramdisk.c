@@ -0,0 +1,128 @@
+#include "devices/ramdisk.h"
+#include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/block.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* RAM disk.
+
+   A block device, named "ramdisk", whose sectors are kept in
+   pages from the kernel pool.  It has no partition table and
+   starts out zeroed, so it is only used in a role that names it,
+   e.g. "-swap=ramdisk" or "-filesys=ramdisk -f".  Transfers are
+   just memcpy() calls in the caller's thread, which makes it
+   useful for measuring what the rest of the kernel costs
+   without a disk in the way. */
+
+/* Number of sectors per page. */
+#define SECTORS_PER_PAGE (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* See ramdisk.h. */
+size_t ramdisk_kb;
+
+static uint8_t **pages;                 /* Pages holding the sectors. */
+
+static struct block_operations ramdisk_operations;
+
+/* Creates and registers the RAM disk, if "-ramdisk" asked for
+   one.  Panics if memory runs out. */
+void
+ramdisk_init (void)
+{
+  block_sector_t sector_cnt;
+  size_t page_cnt, i;
+
+  if (ramdisk_kb == 0)
+    return;
+
+  page_cnt = DIV_ROUND_UP (ramdisk_kb * 1024, PGSIZE);
+  sector_cnt = page_cnt * SECTORS_PER_PAGE;
+  pages = malloc (page_cnt * sizeof *pages);
+  if (pages == NULL)
+    PANIC ("ramdisk: out of memory for %zu page pointers", page_cnt);
+  for (i = 0; i < page_cnt; i++)
+    {
+      pages[i] = palloc_get_page (PAL_ZERO);
+      if (pages[i] == NULL)
+        PANIC ("ramdisk: out of memory after %zu of %zu pages",
+               i, page_cnt);
+    }
+
+  block_register ("ramdisk", BLOCK_RAW, "RAM disk", sector_cnt,
+                  &ramdisk_operations, NULL);
+}
+
+/* Returns the memory that holds SECTOR. */
+static uint8_t *
+sector_addr (block_sector_t sector)
+{
+  return (pages[sector / SECTORS_PER_PAGE]
+          + sector % SECTORS_PER_PAGE * BLOCK_SECTOR_SIZE);
+}
+
+/* Reads CNT sectors starting at SECTOR into BUFFER. */
+static void
+ramdisk_read_multiple (void *aux UNUSED, block_sector_t sector, size_t cnt,
+                       void *buffer)
+{
+  uint8_t *p = buffer;
+
+  while (cnt > 0)
+    {
+      size_t chunk = SECTORS_PER_PAGE - sector % SECTORS_PER_PAGE;
+      if (chunk > cnt)
+        chunk = cnt;
+
+      memcpy (p, sector_addr (sector), chunk * BLOCK_SECTOR_SIZE);
+      p += chunk * BLOCK_SECTOR_SIZE;
+      sector += chunk;
+      cnt -= chunk;
+    }
+}
+
+/* Writes CNT sectors starting at SECTOR from BUFFER. */
+static void
+ramdisk_write_multiple (void *aux UNUSED, block_sector_t sector, size_t cnt,
+                        const void *buffer)
+{
+  const uint8_t *p = buffer;
+
+  while (cnt > 0)
+    {
+      size_t chunk = SECTORS_PER_PAGE - sector % SECTORS_PER_PAGE;
+      if (chunk > cnt)
+        chunk = cnt;
+
+      memcpy (sector_addr (sector), p, chunk * BLOCK_SECTOR_SIZE);
+      p += chunk * BLOCK_SECTOR_SIZE;
+      sector += chunk;
+      cnt -= chunk;
+    }
+}
+
+/* Reads SECTOR into BUFFER. */
+static void
+ramdisk_read (void *aux UNUSED, block_sector_t sector, void *buffer)
+{
+  memcpy (buffer, sector_addr (sector), BLOCK_SECTOR_SIZE);
+}
+
+/* Writes SECTOR from BUFFER. */
+static void
+ramdisk_write (void *aux UNUSED, block_sector_t sector, const void *buffer)
+{
+  memcpy (sector_addr (sector), buffer, BLOCK_SECTOR_SIZE);
+}
+
+static struct block_operations ramdisk_operations =
+  {
+    ramdisk_read,
+    ramdisk_write,
+    ramdisk_read_multiple,
+    ramdisk_write_multiple,
+    NULL
+  };
@@ -3,8 +3,12 @@
 #include <inttypes.h>
 #include <round.h>
 #include <stdio.h>
+#include <time-page.h>
 #include "devices/pit.h"
 #include "threads/interrupt.h"
+#include "threads/io.h"
+#include "threads/palloc.h"
+#include "threads/profile.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
   
@@ -17,14 +21,21 @@
 #error TIMER_FREQ <= 1000 recommended
 #endif
 
-/* Number of timer ticks since OS booted. */
+/* Number of timer ticks since OS booted.
+   Written only by the timer interrupt handler, under ticks_seq. */
 static int64_t ticks;
+static struct seqlock ticks_seq;
+
+/* The page that user processes map read-only to read the time
+   without a system call.  Updated with ticks. */
+static struct time_page *time_page;
 
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
 static intr_handler_func timer_interrupt;
+static void time_page_update (void);
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
@@ -35,19 +46,37 @@ static void real_time_delay (int64_t num, int32_t denom);
 void
 timer_init (void) 
 {
+  seqlock_init (&ticks_seq);
+  time_page = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+  time_page->ticks_per_sec = TIMER_FREQ;
   pit_configure_channel (0, 2, TIMER_FREQ);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
 
-/* Calibrates loops_per_tick, used to implement brief delays. */
+/* Calibrates loops_per_tick, used to implement brief delays.
+   Also measures the time-stamp counter against the timer, for
+   the time page. */
 void
 timer_calibrate (void) 
 {
   unsigned high_bit, test_bit;
+  int64_t start_ticks, start;
+  uint64_t start_tsc;
+  enum intr_level old_level;
 
   ASSERT (intr_get_level () == INTR_ON);
   printf ("Calibrating timer...  ");
 
+  /* Note the TSC at a timer tick.  The timer interrupt records
+     it in the time page. */
+  start = ticks;
+  while (ticks == start)
+    barrier ();
+  old_level = intr_disable ();
+  start_ticks = time_page->ticks;
+  start_tsc = time_page->tsc;
+  intr_set_level (old_level);
+
   /* Approximate loops_per_tick as the largest power-of-two
      still less than one timer tick. */
   loops_per_tick = 1u << 10;
@@ -63,16 +92,43 @@ timer_calibrate (void)
     if (!too_many_loops (high_bit | test_bit))
       loops_per_tick |= test_bit;
 
+  /* Calibration spans many ticks, so the TSC's rate over them
+     is a good estimate. */
+  old_level = intr_disable ();
+  time_page->sequence++;
+  barrier ();
+  time_page->tsc_per_tick = ((time_page->tsc - start_tsc)
+                             / (time_page->ticks - start_ticks));
+  barrier ();
+  time_page->sequence++;
+  intr_set_level (old_level);
+
   printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
 }
 
-/* Returns the number of timer ticks since the OS booted. */
+/* Returns the time page, which load() maps into every user
+   process at TIME_PAGE_ADDR. */
+struct time_page *
+timer_time_page (void) 
+{
+  return time_page;
+}
+
+/* Returns the number of timer ticks since the OS booted.
+   The 64-bit counter cannot be read atomically, so we retry if
+   a timer interrupt updated it while we were reading. */
 int64_t
 timer_ticks (void) 
 {
-  enum intr_level old_level = intr_disable ();
-  int64_t t = ticks;
-  intr_set_level (old_level);
+  unsigned start;
+  int64_t t;
+
+  do
+    {
+      start = seqlock_read_begin (&ticks_seq);
+      t = ticks;
+    }
+  while (seqlock_read_retry (&ticks_seq, start));
   return t;
 }
 
@@ -168,12 +224,32 @@ timer_print_stats (void)
 
 /* Timer interrupt handler. */
 static void
-timer_interrupt (struct intr_frame *args UNUSED)
+timer_interrupt (struct intr_frame *args)
 {
+  seqlock_write_begin (&ticks_seq);
   ticks++;
+  seqlock_write_end (&ticks_seq);
+  time_page_update ();
+  if (profile_sampling)
+    profile_sample (args);
   thread_tick ();
 }
 
+/* Copies the tick count, and the TSC at which it changed, to
+   the time page.  Runs in the timer interrupt, and processes
+   only read the page, so the sequence count alone keeps them
+   from seeing a half-written update. */
+static void
+time_page_update (void) 
+{
+  time_page->sequence++;
+  barrier ();
+  time_page->ticks = ticks;
+  time_page->tsc = rdtsc ();
+  barrier ();
+  time_page->sequence++;
+}
+
 /* Returns true if LOOPS iterations waits for more than one timer
    tick, otherwise false. */
 static bool
@@ -7,8 +7,11 @@
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+struct time_page;
+
 void timer_init (void);
 void timer_calibrate (void);
+struct time_page *timer_time_page (void);
 
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
@@ -0,0 +1,458 @@
+#include "devices/virtio-blk.h"
+#include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/block.h"
+#include "devices/partition.h"
+#include "devices/pci.h"
+#include "threads/interrupt.h"
+#include "threads/io.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Driver for virtio block devices, as emulated by QEMU, using
+   the "legacy" PCI transport of the virtio 0.9.5 specification.
+
+   Each request is a chain of descriptors in the device's single
+   virtqueue: a header the device reads, the data buffers, and a
+   status byte the device writes.  Any number of threads may have
+   requests outstanding at once, up to the size of the queue;
+   each one sleeps until the interrupt handler finds its request
+   in the queue's used ring.  There is no request queue in the
+   block layer in front of the driver, because the device does
+   its own scheduling and the emulator gains nothing from
+   requests that arrive one at a time. */
+
+/* PCI IDs of a legacy (or "transitional") virtio block device. */
+#define VIRTIO_VENDOR 0x1af4
+#define VIRTIO_BLK_DEVICE 0x1001
+
+/* Legacy virtio registers, as offsets from BAR 0.  The
+   device-specific configuration follows the common registers
+   because we do not enable MSI-X. */
+#define REG_DEVICE_FEATURES 0x00        /* Features device offers. */
+#define REG_GUEST_FEATURES 0x04         /* Features driver accepts. */
+#define REG_QUEUE_PFN 0x08              /* Physical page of virtqueue. */
+#define REG_QUEUE_SIZE 0x0c             /* Entries in virtqueue. */
+#define REG_QUEUE_SELECT 0x0e           /* Virtqueue for other regs. */
+#define REG_QUEUE_NOTIFY 0x10           /* Virtqueue with new requests. */
+#define REG_STATUS 0x12                 /* Device status. */
+#define REG_ISR 0x13                    /* Interrupt status, read clears. */
+#define REG_CAPACITY 0x14               /* Size in sectors, 64 bits. */
+
+/* Device status bits. */
+#define STA_ACKNOWLEDGE 0x01            /* Driver found the device. */
+#define STA_DRIVER 0x02                 /* Driver knows how to drive it. */
+#define STA_DRIVER_OK 0x04              /* Driver is ready. */
+#define STA_FAILED 0x80                 /* Driver gave up. */
+
+/* Virtqueue descriptor. */
+struct vring_desc
+  {
+    uint64_t addr;                      /* Physical address of buffer. */
+    uint32_t len;                       /* Length of buffer in bytes. */
+    uint16_t flags;                     /* VRING_DESC_F_*. */
+    uint16_t next;                      /* Next descriptor in chain. */
+  };
+
+#define VRING_DESC_F_NEXT 1             /* NEXT is valid. */
+#define VRING_DESC_F_WRITE 2            /* Device writes the buffer. */
+
+/* Ring of descriptor chains made available to the device. */
+struct vring_avail
+  {
+    uint16_t flags;
+    uint16_t idx;                       /* Next entry to fill, mod size. */
+    uint16_t ring[];                    /* Head descriptors. */
+  };
+
+/* Ring of descriptor chains that the device has finished with. */
+struct vring_used_elem
+  {
+    uint32_t id;                        /* Head descriptor. */
+    uint32_t len;                       /* Bytes written by device. */
+  };
+
+struct vring_used
+  {
+    uint16_t flags;
+    uint16_t idx;                       /* Next entry to fill, mod size. */
+    struct vring_used_elem ring[];
+  };
+
+/* The used ring starts at this alignment in the legacy layout. */
+#define VRING_ALIGN 4096
+
+/* Block request header, read by the device. */
+struct virtio_blk_hdr
+  {
+    uint32_t type;                      /* VIRTIO_BLK_T_*. */
+    uint32_t reserved;
+    uint64_t sector;                    /* First sector. */
+  };
+
+#define VIRTIO_BLK_T_IN 0               /* Read. */
+#define VIRTIO_BLK_T_OUT 1              /* Write. */
+#define VIRTIO_BLK_S_OK 0               /* Status: success. */
+
+/* An outstanding request.  Lives on the stack of the thread
+   waiting for it, which is in kernel virtual memory and so may
+   be handed to the device. */
+struct vblk_request
+  {
+    struct virtio_blk_hdr hdr;          /* Request header. */
+    uint8_t status;                     /* Written by device. */
+    struct semaphore done;              /* Up'd by interrupt handler. */
+  };
+
+/* A virtio block device. */
+struct vblk_disk
+  {
+    char name[8];                       /* Name, e.g. "vda". */
+    uint16_t io_base;                   /* BAR 0. */
+    uint8_t irq;                        /* Interrupt vector. */
+
+    /* Virtqueue. */
+    uint16_t queue_size;                /* Number of descriptors. */
+    struct vring_desc *desc;            /* Descriptor table. */
+    struct vring_avail *avail;          /* Available ring. */
+    volatile struct vring_used *used;   /* Used ring. */
+    struct vblk_request **inflight;     /* Request by head descriptor. */
+    uint16_t last_used;                 /* Next used entry to process. */
+
+    /* Free descriptors, chained through their NEXT members. */
+    struct lock lock;                   /* Protects descriptors, AVAIL. */
+    struct condition desc_free;         /* Signaled when some are freed. */
+    uint16_t free_head;                 /* First free descriptor. */
+    uint16_t free_cnt;                  /* Number of free descriptors. */
+  };
+
+/* Most virtio block devices we support. */
+#define DISK_CNT 4
+static struct vblk_disk disks[DISK_CNT];
+static size_t disk_cnt;
+
+static struct block_operations vblk_operations;
+
+static bool init_disk (struct vblk_disk *, const struct pci_dev *);
+static bool init_queue (struct vblk_disk *);
+static void interrupt_handler (struct intr_frame *);
+
+/* Finds and initializes virtio block devices. */
+void
+virtio_blk_init (void)
+{
+  struct pci_dev pci;
+
+  while (disk_cnt < DISK_CNT
+         && pci_find_device (VIRTIO_VENDOR, VIRTIO_BLK_DEVICE, disk_cnt, &pci))
+    {
+      struct vblk_disk *d = &disks[disk_cnt];
+
+      snprintf (d->name, sizeof d->name, "vd%c", 'a' + (int) disk_cnt);
+      disk_cnt++;
+      if (!init_disk (d, &pci))
+        printf ("%s: initialization failed\n", d->name);
+    }
+}
+
+/* Brings up device D, found at PCI, and registers it as a block
+   device.  Returns false if the device cannot be used. */
+static bool
+init_disk (struct vblk_disk *d, const struct pci_dev *pci)
+{
+  uint32_t capacity_lo, capacity_hi;
+  block_sector_t capacity;
+  struct block *block;
+  size_t i;
+
+  d->io_base = pci_io_bar (pci, 0);
+  if (d->io_base == 0 || pci->irq == 0 || pci->irq >= 16)
+    return false;
+  d->irq = pci->irq + 0x20;
+  pci_enable_bus_master (pci);
+
+  /* Reset, then tell the device that we know what it is.  We
+     need none of the optional features. */
+  outb (d->io_base + REG_STATUS, 0);
+  outb (d->io_base + REG_STATUS, STA_ACKNOWLEDGE);
+  outb (d->io_base + REG_STATUS, STA_ACKNOWLEDGE | STA_DRIVER);
+  inl (d->io_base + REG_DEVICE_FEATURES);
+  outl (d->io_base + REG_GUEST_FEATURES, 0);
+
+  if (!init_queue (d))
+    {
+      outb (d->io_base + REG_STATUS, STA_FAILED);
+      return false;
+    }
+  lock_init (&d->lock);
+  cond_init (&d->desc_free);
+  d->free_head = 0;
+  d->free_cnt = d->queue_size;
+  for (i = 0; i < d->queue_size; i++)
+    d->desc[i].next = i + 1;
+  d->last_used = 0;
+
+  /* Disks may share an interrupt line, so register the handler
+     only for the first disk on each. */
+  for (i = 0; &disks[i] != d; i++)
+    if (disks[i].irq == d->irq && disks[i].desc != NULL)
+      break;
+  if (&disks[i] == d)
+    intr_register_ext (d->irq, interrupt_handler, "virtio-blk");
+  outb (d->io_base + REG_STATUS,
+        STA_ACKNOWLEDGE | STA_DRIVER | STA_DRIVER_OK);
+
+  /* Block devices are limited to 2**32 sectors. */
+  capacity_lo = inl (d->io_base + REG_CAPACITY);
+  capacity_hi = inl (d->io_base + REG_CAPACITY + 4);
+  capacity = capacity_hi != 0 ? UINT32_MAX : capacity_lo;
+
+  block = block_register (d->name, BLOCK_RAW, "virtio", capacity,
+                          &vblk_operations, d);
+  partition_scan (block);
+  return true;
+}
+
+/* Allocates and lays out queue 0 of disk D and tells the device
+   where it is.  Returns false if the device has no queue or
+   memory is short. */
+static bool
+init_queue (struct vblk_disk *d)
+{
+  size_t n, used_ofs, page_cnt;
+  uint8_t *mem;
+
+  outw (d->io_base + REG_QUEUE_SELECT, 0);
+  n = inw (d->io_base + REG_QUEUE_SIZE);
+  if (n == 0)
+    return false;
+
+  /* Legacy layout: the descriptor table, then the available
+     ring, then, at the next VRING_ALIGN boundary, the used ring,
+     all physically contiguous. */
+  used_ofs = ROUND_UP (n * sizeof *d->desc
+                       + sizeof *d->avail + (n + 1) * sizeof (uint16_t),
+                       VRING_ALIGN);
+  page_cnt = DIV_ROUND_UP (used_ofs + sizeof *d->used
+                           + n * sizeof (struct vring_used_elem)
+                           + sizeof (uint16_t), PGSIZE);
+  mem = palloc_get_multiple (PAL_ZERO, page_cnt);
+  d->inflight = palloc_get_multiple (PAL_ZERO,
+                                     DIV_ROUND_UP (n * sizeof *d->inflight,
+                                                   PGSIZE));
+  if (mem == NULL || d->inflight == NULL)
+    return false;
+
+  d->queue_size = n;
+  d->desc = (struct vring_desc *) mem;
+  d->avail = (struct vring_avail *) (mem + n * sizeof *d->desc);
+  d->used = (struct vring_used *) (mem + used_ofs);
+  outl (d->io_base + REG_QUEUE_PFN, vtop (mem) / PGSIZE);
+  return true;
+}
+
+/* Takes a free descriptor from disk D, which must have one.
+   D's lock must be held. */
+static uint16_t
+alloc_desc (struct vblk_disk *d)
+{
+  uint16_t i = d->free_head;
+
+  ASSERT (d->free_cnt > 0);
+  d->free_head = d->desc[i].next;
+  d->free_cnt--;
+  return i;
+}
+
+/* Returns the chain of descriptors starting at HEAD to disk D's
+   free list.  D's lock must be held. */
+static void
+free_chain (struct vblk_disk *d, uint16_t head)
+{
+  for (;;)
+    {
+      struct vring_desc *desc = &d->desc[head];
+      uint16_t next = desc->next;
+      bool more = desc->flags & VRING_DESC_F_NEXT;
+
+      desc->next = d->free_head;
+      d->free_head = head;
+      d->free_cnt++;
+      if (!more)
+        break;
+      head = next;
+    }
+}
+
+/* Appends descriptor I for SIZE bytes at BUFFER, with the given
+   FLAGS, to the chain ending at *PREV on disk D. */
+static void
+add_desc (struct vblk_disk *d, uint16_t *prev, uint16_t i,
+          const void *buffer, size_t size, uint16_t flags)
+{
+  d->desc[i].addr = vtop (buffer);
+  d->desc[i].len = size;
+  d->desc[i].flags = flags;
+  d->desc[*prev].next = i;
+  d->desc[*prev].flags |= VRING_DESC_F_NEXT;
+  *prev = i;
+}
+
+/* Transfers the IOV_CNT buffers in IOV, in order, between disk D
+   and the consecutive sectors starting at SEC_NO: reads from the
+   disk if WRITE is false, writes to it if WRITE is true.  The
+   buffers must be in kernel virtual memory.  Returns after the
+   device has completed the transfer.  Any number of threads may
+   call this at once. */
+static void
+vblk_transfer (void *d_, block_sector_t sec_no,
+               const struct block_iovec *iov, size_t iov_cnt, bool write)
+{
+  struct vblk_disk *d = d_;
+  struct vblk_request r;
+  uint16_t head, prev;
+  size_t i;
+
+  /* A chain needs a descriptor for each buffer, plus the header
+     and status.  Split requests too long for a small queue. */
+  if (iov_cnt + 2 > d->queue_size)
+    {
+      for (i = 0; i < iov_cnt; i++)
+        {
+          vblk_transfer (d, sec_no, &iov[i], 1, write);
+          sec_no += iov[i].cnt;
+        }
+      return;
+    }
+
+  r.hdr.type = write ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN;
+  r.hdr.reserved = 0;
+  r.hdr.sector = sec_no;
+  r.status = 0xff;
+  sema_init (&r.done, 0);
+
+  lock_acquire (&d->lock);
+  while (d->free_cnt < iov_cnt + 2)
+    cond_wait (&d->desc_free, &d->lock);
+
+  /* Build the chain.  Each buffer is physically contiguous
+     because kernel virtual memory maps physical memory
+     linearly. */
+  head = prev = alloc_desc (d);
+  d->desc[head].addr = vtop (&r.hdr);
+  d->desc[head].len = sizeof r.hdr;
+  d->desc[head].flags = 0;
+  for (i = 0; i < iov_cnt; i++)
+    add_desc (d, &prev, alloc_desc (d), iov[i].buffer,
+              iov[i].cnt * BLOCK_SECTOR_SIZE,
+              write ? 0 : VRING_DESC_F_WRITE);
+  add_desc (d, &prev, alloc_desc (d), &r.status, 1, VRING_DESC_F_WRITE);
+  d->inflight[head] = &r;
+
+  /* Publish the chain, then the new index, then tell the
+     device. */
+  d->avail->ring[d->avail->idx % d->queue_size] = head;
+  barrier ();
+  d->avail->idx++;
+  barrier ();
+  outw (d->io_base + REG_QUEUE_NOTIFY, 0);
+  lock_release (&d->lock);
+
+  sema_down (&r.done);
+  if (r.status != VIRTIO_BLK_S_OK)
+    PANIC ("%s: disk %s failed, sector=%"PRDSNu" (status %d)",
+           d->name, write ? "write" : "read", sec_no, r.status);
+
+  lock_acquire (&d->lock);
+  free_chain (d, head);
+  cond_broadcast (&d->desc_free, &d->lock);
+  lock_release (&d->lock);
+}
+
+/* Reads sector SEC_NO from disk D into BUFFER. */
+static void
+vblk_read (void *d, block_sector_t sec_no, void *buffer)
+{
+  struct block_iovec iov;
+
+  iov.buffer = buffer;
+  iov.cnt = 1;
+  vblk_transfer (d, sec_no, &iov, 1, false);
+}
+
+/* Writes sector SEC_NO to disk D from BUFFER. */
+static void
+vblk_write (void *d, block_sector_t sec_no, const void *buffer)
+{
+  struct block_iovec iov;
+
+  iov.buffer = (void *) buffer;
+  iov.cnt = 1;
+  vblk_transfer (d, sec_no, &iov, 1, true);
+}
+
+/* Reads CNT sectors starting at SEC_NO from disk D into
+   BUFFER. */
+static void
+vblk_read_multiple (void *d, block_sector_t sec_no, size_t cnt,
+                    void *buffer)
+{
+  struct block_iovec iov;
+
+  iov.buffer = buffer;
+  iov.cnt = cnt;
+  vblk_transfer (d, sec_no, &iov, 1, false);
+}
+
+/* Writes CNT sectors starting at SEC_NO to disk D from
+   BUFFER. */
+static void
+vblk_write_multiple (void *d, block_sector_t sec_no, size_t cnt,
+                     const void *buffer)
+{
+  struct block_iovec iov;
+
+  iov.buffer = (void *) buffer;
+  iov.cnt = cnt;
+  vblk_transfer (d, sec_no, &iov, 1, true);
+}
+
+static struct block_operations vblk_operations =
+  {
+    vblk_read,
+    vblk_write,
+    vblk_read_multiple,
+    vblk_write_multiple,
+    vblk_transfer
+  };
+
+/* Virtio interrupt handler.  Wakes up the thread waiting for
+   each request that the devices on this interrupt line have
+   completed. */
+static void
+interrupt_handler (struct intr_frame *f)
+{
+  struct vblk_disk *d;
+
+  for (d = disks; d < disks + disk_cnt; d++)
+    if (d->irq == f->vec_no && d->desc != NULL)
+      {
+        /* Reading the ISR acknowledges the interrupt. */
+        inb (d->io_base + REG_ISR);
+        while (d->last_used != d->used->idx)
+          {
+            struct vblk_request *r;
+            uint16_t id;
+
+            barrier ();
+            id = d->used->ring[d->last_used % d->queue_size].id;
+            r = d->inflight[id];
+            d->inflight[id] = NULL;
+            d->last_used++;
+            sema_up (&r->done);
+          }
+      }
+}
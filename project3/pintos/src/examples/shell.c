@@ -5,6 +5,10 @@
 
 static void read_line (char line[], size_t);
 static bool backspace (char **pos, char line[]);
+static void run_pipeline (char *command);
+
+/* Most commands in one pipeline. */
+#define MAX_STAGES 8
 
 int
 main (void)
@@ -30,6 +34,8 @@ main (void)
         {
           /* Empty command. */
         }
+      else if (strchr (command, '|') != NULL)
+        run_pipeline (command);
       else
         {
           pid_t pid = exec (command);
@@ -102,3 +108,71 @@ backspace (char **pos, char line[])
   else
     return false;
 }
+
+/* Runs COMMAND, a series of commands separated by "|", with each
+   command's standard output connected to the next one's
+   standard input by a pipe, and waits for all of them.
+
+   The children inherit our file descriptors, so each one is
+   started with our own standard input and output pointed at the
+   right pipe ends by dup2(), and closing them afterward sends
+   them back to the console.  Every other pipe end is closed
+   before the next command starts, so that each reader sees end
+   of file once the command before it exits. */
+static void
+run_pipeline (char *command)
+{
+  char *stages[MAX_STAGES];
+  pid_t pids[MAX_STAGES];
+  int stage_cnt = 0;
+  char *stage, *save_ptr;
+  int i;
+
+  for (stage = strtok_r (command, "|", &save_ptr); stage != NULL;
+       stage = strtok_r (NULL, "|", &save_ptr))
+    {
+      if (stage_cnt == MAX_STAGES)
+        {
+          printf ("too many commands in pipeline\n");
+          return;
+        }
+      stages[stage_cnt++] = stage;
+    }
+
+  for (i = 0; i < stage_cnt; i++)
+    {
+      bool last = i == stage_cnt - 1;
+      int fds[2];
+
+      if (!last)
+        {
+          if (!pipe (fds))
+            {
+              if (i > 0)
+                close (STDIN_FILENO);
+              printf ("pipe failed\n");
+              stage_cnt = i;
+              break;
+            }
+          dup2 (fds[1], STDOUT_FILENO);
+          close (fds[1]);
+        }
+
+      pids[i] = exec (stages[i]);
+
+      if (i > 0)
+        close (STDIN_FILENO);
+      if (!last)
+        {
+          close (STDOUT_FILENO);
+          dup2 (fds[0], STDIN_FILENO);
+          close (fds[0]);
+        }
+    }
+
+  for (i = 0; i < stage_cnt; i++)
+    if (pids[i] != PID_ERROR)
+      printf ("\"%s\": exit code %d\n", stages[i], wait (pids[i]));
+    else
+      printf ("\"%s\": exec failed\n", stages[i]);
+}
@@ -113,6 +113,19 @@ file_write_at (struct file *file, const void *buffer, off_t size,
   return inode_write_at (file->inode, buffer, size, file_ofs);
 }
 
+/* Copies SIZE bytes from IN, starting at offset IN_OFS, to OUT,
+   starting at offset OUT_OFS, without going through a caller's
+   buffer.
+   Returns the number of bytes actually copied,
+   which may be less than SIZE if end of either file is reached.
+   Neither file's current position is affected. */
+off_t
+file_copy_at (struct file *in, off_t in_ofs, struct file *out,
+              off_t out_ofs, off_t size)
+{
+  return inode_copy_at (in->inode, in_ofs, out->inode, out_ofs, size);
+}
+
 /* Prevents write operations on FILE's underlying inode
    until file_allow_write() is called or FILE is closed. */
 void
@@ -1,5 +1,6 @@
 #include "filesys/fsutil.h"
 #include <debug.h>
+#include <round.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -7,8 +8,11 @@
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "devices/block.h"
+#include "devices/timer.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* List files in the root directory. */
@@ -66,6 +70,10 @@ fsutil_rm (char **argv)
     PANIC ("%s: delete failed\n", file_name);
 }
 
+/* Number of sectors of file data that fsutil_extract() reads
+   from the scratch device at a time. */
+#define EXTRACT_SECTORS 32
+
 /* Extracts a ustar-format tar archive from the scratch block
    device into the Pintos file system. */
 void
@@ -78,7 +86,7 @@ fsutil_extract (char **argv UNUSED)
 
   /* Allocate buffers. */
   header = malloc (BLOCK_SECTOR_SIZE);
-  data = malloc (BLOCK_SECTOR_SIZE);
+  data = malloc (EXTRACT_SECTORS * BLOCK_SECTOR_SIZE);
   if (header == NULL || data == NULL)
     PANIC ("couldn't allocate buffers");
 
@@ -126,10 +134,12 @@ fsutil_extract (char **argv UNUSED)
           /* Do copy. */
           while (size > 0)
             {
-              int chunk_size = (size > BLOCK_SECTOR_SIZE
-                                ? BLOCK_SECTOR_SIZE
+              int chunk_size = (size > EXTRACT_SECTORS * BLOCK_SECTOR_SIZE
+                                ? EXTRACT_SECTORS * BLOCK_SECTOR_SIZE
                                 : size);
-              block_read (src, sector++, data);
+              size_t sector_cnt = DIV_ROUND_UP (chunk_size, BLOCK_SECTOR_SIZE);
+              block_read_multiple (src, sector, sector_cnt, data);
+              sector += sector_cnt;
               if (file_write (dst, data, chunk_size) != chunk_size)
                 PANIC ("%s: write failed with %d bytes unwritten",
                        file_name, size);
@@ -220,3 +230,74 @@ fsutil_append (char **argv)
   file_close (src);
   free (buffer);
 }
+
+/* Number of pages in each fsutil_diskbench() request. */
+#define BENCH_PAGES 16
+
+static void bench_pass (struct block *, const char *what, size_t sector_cnt,
+                        void *buffer, bool write);
+
+/* Writes and then reads back ARGV[1] megabytes on the scratch
+   block device, BENCH_PAGES pages per request, and reports the
+   throughput and the CPU time taken per megabyte.  CPU time is
+   whatever time the idle thread did not get.  Destroys the
+   contents of the scratch device. */
+void
+fsutil_diskbench (char **argv) 
+{
+  size_t mb = atoi (argv[1]);
+  struct block *dev;
+  void *buffer;
+
+  dev = block_get_role (BLOCK_SCRATCH);
+  if (dev == NULL)
+    PANIC ("couldn't open scratch device");
+  if (block_size (dev) < BENCH_PAGES * PGSIZE / BLOCK_SECTOR_SIZE)
+    PANIC ("scratch device too small for benchmark");
+
+  buffer = palloc_get_multiple (PAL_ASSERT, BENCH_PAGES);
+  memset (buffer, 0x5a, BENCH_PAGES * PGSIZE);
+
+  printf ("Benchmarking %zu MB on %s...\n", mb, block_name (dev));
+  bench_pass (dev, "write", mb * (1024 * 1024 / BLOCK_SECTOR_SIZE),
+              buffer, true);
+  bench_pass (dev, "read", mb * (1024 * 1024 / BLOCK_SECTOR_SIZE),
+              buffer, false);
+
+  palloc_free_multiple (buffer, BENCH_PAGES);
+}
+
+/* Transfers SECTOR_CNT sectors between DEV and BUFFER, wrapping
+   around at the end of DEV, and prints the results labeled
+   WHAT. */
+static void
+bench_pass (struct block *dev, const char *what, size_t sector_cnt,
+            void *buffer, bool write) 
+{
+  const size_t chunk = BENCH_PAGES * PGSIZE / BLOCK_SECTOR_SIZE;
+  block_sector_t sector = 0;
+  int64_t start, ticks;
+  long long idle, busy;
+  size_t done;
+
+  start = timer_ticks ();
+  idle = thread_idle_ticks ();
+  for (done = 0; done < sector_cnt; done += chunk)
+    {
+      if (sector + chunk > block_size (dev))
+        sector = 0;
+      if (write)
+        block_write_multiple (dev, sector, chunk, buffer);
+      else
+        block_read_multiple (dev, sector, chunk, buffer);
+      sector += chunk;
+    }
+  ticks = timer_elapsed (start);
+  busy = ticks - (thread_idle_ticks () - idle);
+
+  /* Report kB/s and CPU milliseconds per MB. */
+  printf ("diskbench: %s %zu kB in %lld ms, %lld kB/s, %lld ms CPU/MB\n",
+          what, done / 2, ticks * 1000 / TIMER_FREQ,
+          ticks > 0 ? (long long) done / 2 * TIMER_FREQ / ticks : 0,
+          done > 0 ? busy * 1000 / TIMER_FREQ * 2048 / (long long) done : 0);
+}
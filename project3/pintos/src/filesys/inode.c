@@ -5,7 +5,11 @@
 #include <string.h>
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -54,14 +58,20 @@ byte_to_sector (const struct inode *inode, off_t pos)
 }
 
 /* List of open inodes, so that opening a single inode twice
-   returns the same `struct inode'. */
+   returns the same `struct inode'.  Most opens find the inode
+   already on the list, so lookups only take open_inodes_lock
+   for reading. */
 static struct list open_inodes;
+static struct rwlock open_inodes_lock;
+
+static struct inode *find_open_inode (block_sector_t sector);
 
 /* Initializes the inode module. */
 void
 inode_init (void) 
 {
   list_init (&open_inodes);
+  rwlock_init (&open_inodes_lock);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -111,25 +121,32 @@ inode_create (block_sector_t sector, off_t length)
 struct inode *
 inode_open (block_sector_t sector)
 {
-  struct list_elem *e;
   struct inode *inode;
 
   /* Check whether this inode is already open. */
-  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-       e = list_next (e)) 
+  rwlock_acquire_read (&open_inodes_lock);
+  inode = inode_reopen (find_open_inode (sector));
+  rwlock_release_read (&open_inodes_lock);
+  if (inode != NULL)
+    return inode;
+
+  /* Not open yet.  Check again with exclusive access, because
+     another thread may have opened it in the meantime. */
+  rwlock_acquire_write (&open_inodes_lock);
+  inode = inode_reopen (find_open_inode (sector));
+  if (inode != NULL)
     {
-      inode = list_entry (e, struct inode, elem);
-      if (inode->sector == sector) 
-        {
-          inode_reopen (inode);
-          return inode; 
-        }
+      rwlock_release_write (&open_inodes_lock);
+      return inode;
     }
 
   /* Allocate memory. */
   inode = malloc (sizeof *inode);
   if (inode == NULL)
-    return NULL;
+    {
+      rwlock_release_write (&open_inodes_lock);
+      return NULL;
+    }
 
   /* Initialize. */
   list_push_front (&open_inodes, &inode->elem);
@@ -138,15 +155,39 @@ inode_open (block_sector_t sector)
   inode->deny_write_cnt = 0;
   inode->removed = false;
   block_read (fs_device, inode->sector, &inode->data);
+  rwlock_release_write (&open_inodes_lock);
   return inode;
 }
 
-/* Reopens and returns INODE. */
+/* Returns the open inode for SECTOR, or a null pointer if that
+   inode is not open.  The caller must hold open_inodes_lock. */
+static struct inode *
+find_open_inode (block_sector_t sector)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
+       e = list_next (e)) 
+    {
+      struct inode *inode = list_entry (e, struct inode, elem);
+      if (inode->sector == sector) 
+        return inode;
+    }
+  return NULL;
+}
+
+/* Reopens and returns INODE.
+   Several readers of open_inodes may reopen the same inode at
+   once, so the count is updated with interrupts off. */
 struct inode *
 inode_reopen (struct inode *inode)
 {
   if (inode != NULL)
-    inode->open_cnt++;
+    {
+      enum intr_level old_level = intr_disable ();
+      inode->open_cnt++;
+      intr_set_level (old_level);
+    }
   return inode;
 }
 
@@ -163,15 +204,24 @@ inode_get_inumber (const struct inode *inode)
 void
 inode_close (struct inode *inode) 
 {
+  enum intr_level old_level;
+  bool last;
+
   /* Ignore null pointer. */
   if (inode == NULL)
     return;
 
+  rwlock_acquire_write (&open_inodes_lock);
+  old_level = intr_disable ();
+  last = --inode->open_cnt == 0;
+  intr_set_level (old_level);
+
   /* Release resources if this was the last opener. */
-  if (--inode->open_cnt == 0)
+  if (last)
     {
       /* Remove from inode list and release lock. */
       list_remove (&inode->elem);
+      rwlock_release_write (&open_inodes_lock);
  
       /* Deallocate blocks if removed. */
       if (inode->removed) 
@@ -183,6 +233,8 @@ inode_close (struct inode *inode)
 
       free (inode); 
     }
+  else
+    rwlock_release_write (&open_inodes_lock);
 }
 
 /* Marks INODE to be deleted when it is closed by the last caller who
@@ -222,8 +274,14 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
 
       if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
         {
-          /* Read full sector directly into caller's buffer. */
-          block_read (fs_device, sector_idx, buffer + bytes_read);
+          /* Read as many full sectors as we can directly into
+             caller's buffer.  A file's sectors are contiguous on
+             disk, so this takes a single request. */
+          off_t left = size < inode_left ? size : inode_left;
+          size_t sector_cnt = left / BLOCK_SECTOR_SIZE;
+          block_read_multiple (fs_device, sector_idx, sector_cnt,
+                               buffer + bytes_read);
+          chunk_size = sector_cnt * BLOCK_SECTOR_SIZE;
         }
       else 
         {
@@ -283,8 +341,14 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 
       if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
         {
-          /* Write full sector directly to disk. */
-          block_write (fs_device, sector_idx, buffer + bytes_written);
+          /* Write as many full sectors as we can directly from
+             caller's buffer, in a single request as in
+             inode_read_at(). */
+          off_t left = size < inode_left ? size : inode_left;
+          size_t sector_cnt = left / BLOCK_SECTOR_SIZE;
+          block_write_multiple (fs_device, sector_idx, sector_cnt,
+                                buffer + bytes_written);
+          chunk_size = sector_cnt * BLOCK_SECTOR_SIZE;
         }
       else 
         {
@@ -317,6 +381,45 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
   return bytes_written;
 }
 
+/* Copies SIZE bytes from IN, starting at IN_OFS, to OUT,
+   starting at OUT_OFS, a page at a time through a kernel buffer.
+   When both offsets are sector-aligned every page moves as one
+   multi-sector read and one multi-sector write.  Returns the
+   number of bytes copied, which may be less than SIZE if the end
+   of either inode is reached or memory is short.  The ranges
+   must not overlap if IN and OUT are the same inode. */
+off_t
+inode_copy_at (struct inode *in, off_t in_ofs, struct inode *out,
+               off_t out_ofs, off_t size)
+{
+  off_t bytes_copied = 0;
+  uint8_t *page;
+
+  page = palloc_get_page (0);
+  if (page == NULL)
+    return 0;
+
+  while (size > 0)
+    {
+      off_t chunk_size = size < PGSIZE ? size : PGSIZE;
+      off_t n;
+
+      n = inode_read_at (in, page, chunk_size, in_ofs + bytes_copied);
+      if (n > 0)
+        n = inode_write_at (out, page, n, out_ofs + bytes_copied);
+      if (n <= 0)
+        break;
+
+      size -= n;
+      bytes_copied += n;
+      if (n < chunk_size)
+        break;
+    }
+  palloc_free_page (page);
+
+  return bytes_copied;
+}
+
 /* Disables writes to INODE.
    May be called at most once per inode opener. */
 void
@@ -0,0 +1,65 @@
+#ifndef __LIB_IO_RING_H
+#define __LIB_IO_RING_H
+
+/* Layout of the I/O ring page shared by a user process and the
+   kernel.  See ring_setup() and ring_enter() in
+   lib/user/syscall.h.
+
+   The process fills in submission queue entries (SQEs) at
+   sq_tail and advances it; the kernel consumes them from sq_head
+   when the process calls ring_enter().  For each SQE consumed,
+   the kernel posts a completion queue entry (CQE) at cq_tail,
+   which the process reads from cq_head.  Each side writes only
+   its own two indexes.  Indexes count up forever and are reduced
+   to slots with the masks. */
+
+#include <stdint.h>
+
+/* Operations. */
+enum io_ring_op
+  {
+    IO_RING_NOP,                /* Do nothing; result 0. */
+    IO_RING_OPEN,               /* open (addr). */
+    IO_RING_CLOSE,              /* close (fd). */
+    IO_RING_READ,               /* read (fd, addr, len). */
+    IO_RING_WRITE,              /* write (fd, addr, len). */
+    IO_RING_SEEK,               /* seek (fd, offset). */
+    IO_RING_PREAD,              /* pread (fd, addr, len, offset). */
+    IO_RING_PWRITE              /* pwrite (fd, addr, len, offset). */
+  };
+
+/* Submission queue entry. */
+struct io_ring_sqe
+  {
+    uint32_t op;                /* An enum io_ring_op. */
+    int32_t fd;                 /* File descriptor. */
+    uint32_t addr;              /* User buffer or file name. */
+    uint32_t len;               /* Buffer length. */
+    uint32_t offset;            /* File offset. */
+    uint32_t user_data;         /* Copied to the completion. */
+  };
+
+/* Completion queue entry. */
+struct io_ring_cqe
+  {
+    uint32_t user_data;         /* From the submission. */
+    int32_t res;                /* What the system call would return. */
+  };
+
+#define IO_RING_SQ_ENTRIES 64
+#define IO_RING_CQ_ENTRIES 128
+#define IO_RING_SQ_MASK (IO_RING_SQ_ENTRIES - 1)
+#define IO_RING_CQ_MASK (IO_RING_CQ_ENTRIES - 1)
+
+/* The shared page. */
+struct io_ring
+  {
+    uint32_t sq_head;           /* Next SQE to consume.  Kernel. */
+    uint32_t sq_tail;           /* Next free SQE.  Process. */
+    uint32_t cq_head;           /* Next CQE to read.  Process. */
+    uint32_t cq_tail;           /* Next free CQE.  Kernel. */
+    struct io_ring_sqe sq[IO_RING_SQ_ENTRIES];
+    struct io_ring_cqe cq[IO_RING_CQ_ENTRIES];
+  };
+
+#endif /* lib/io-ring.h */
@@ -0,0 +1,38 @@
+#include "histogram.h"
+#include <inttypes.h>
+#include <stdio.h>
+
+/* Adds VALUE to histogram H. */
+void
+histogram_add (struct histogram *h, uint64_t value)
+{
+  uint64_t v = value;
+  int k = 0;
+
+  while (v > 1 && k < HISTOGRAM_BUCKETS - 1)
+    {
+      v >>= 1;
+      k++;
+    }
+  h->bucket[k]++;
+  h->cnt++;
+  h->sum += value;
+  if (value > h->max)
+    h->max = value;
+}
+
+/* Prints histogram H on one line beginning with PREFIX: the
+   count, mean, and maximum, then "K:COUNT" for each nonempty
+   bucket K. */
+void
+histogram_print (const struct histogram *h, const char *prefix)
+{
+  int k;
+
+  printf ("%s: %"PRIu32" samples, mean %"PRIu64", max %"PRIu64";",
+          prefix, h->cnt, h->cnt > 0 ? h->sum / h->cnt : 0, h->max);
+  for (k = 0; k < HISTOGRAM_BUCKETS; k++)
+    if (h->bucket[k] > 0)
+      printf (" %d:%"PRIu32, k, h->bucket[k]);
+  printf ("\n");
+}
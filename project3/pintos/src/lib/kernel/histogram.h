@@ -0,0 +1,26 @@
+#ifndef __LIB_KERNEL_HISTOGRAM_H
+#define __LIB_KERNEL_HISTOGRAM_H
+
+#include <stdint.h>
+
+/* Log2 histogram.
+
+   Bucket K counts the values V with 2**K <= V < 2**(K+1), except
+   that bucket 0 also counts 0 and the last bucket also counts
+   everything larger.  A histogram that is all zeros, as in BSS,
+   is empty and ready to use. */
+
+#define HISTOGRAM_BUCKETS 40
+
+struct histogram
+  {
+    uint32_t bucket[HISTOGRAM_BUCKETS]; /* Counts per power of 2. */
+    uint32_t cnt;                       /* Total count. */
+    uint64_t sum;                       /* Sum of all values. */
+    uint64_t max;                       /* Largest value. */
+  };
+
+void histogram_add (struct histogram *, uint64_t value);
+void histogram_print (const struct histogram *, const char *prefix);
+
+#endif /* lib/kernel/histogram.h */
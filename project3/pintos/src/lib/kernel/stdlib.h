@@ -0,0 +1,7 @@
+#ifndef __LIB_KERNEL_STDLIB_H
+#define __LIB_KERNEL_STDLIB_H
+
+/* The kernel allocator. */
+#include "threads/malloc.h"
+
+#endif /* lib/kernel/stdlib.h */
@@ -1,5 +1,30 @@
 #include <string.h>
 #include <debug.h>
+#include <stdint.h>
+
+/* The block functions below move whole 32-bit words where they
+   can, using the x86 string instructions, and handle the odd
+   bytes at either end separately.  x86 allows unaligned word
+   accesses, so only the destination is aligned: misaligned
+   stores cost more than misaligned loads.
+
+   Word-at-a-time scanning (strlen, memchr) only ever reads
+   aligned words, which never cross a page boundary, so it cannot
+   fault on a page that a byte-at-a-time scan would not touch. */
+
+/* A word that may alias any other type. */
+typedef uint32_t __attribute__ ((may_alias)) word_t;
+
+/* Every byte of a word set to 0x01, or to 0x80. */
+#define ONES 0x01010101u
+#define HIGHS 0x80808080u
+
+/* Nonzero if some byte of word W is zero. */
+#define HAS_ZERO_BYTE(W) (((W) - ONES) & ~(W) & HIGHS)
+
+/* Below this many bytes, aligning and switching instructions
+   costs more than it saves. */
+#define SMALL 16
 
 /* Copies SIZE bytes from SRC to DST, which must not overlap.
    Returns DST. */
@@ -12,8 +37,19 @@ memcpy (void *dst_, const void *src_, size_t size)
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
-  while (size-- > 0)
-    *dst++ = *src++;
+  if (size >= SMALL)
+    {
+      size_t head = -(uintptr_t) dst & 3;
+      size_t words = (size - head) / 4;
+
+      size -= head + words * 4;
+      asm volatile ("rep movsb"
+                    : "+D" (dst), "+S" (src), "+c" (head) : : "memory");
+      asm volatile ("rep movsl"
+                    : "+D" (dst), "+S" (src), "+c" (words) : : "memory");
+    }
+  asm volatile ("rep movsb"
+                : "+D" (dst), "+S" (src), "+c" (size) : : "memory");
 
   return dst_;
 }
@@ -29,20 +65,31 @@ memmove (void *dst_, const void *src_, size_t size)
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
-  if (dst < src) 
+  if (dst <= src || dst >= src + size)
     {
-      while (size-- > 0)
-        *dst++ = *src++;
+      /* Copying upward never overwrites a byte before it is
+         read. */
+      return memcpy (dst_, src_, size);
     }
-  else 
+  else
     {
-      dst += size;
-      src += size;
-      while (size-- > 0)
-        *--dst = *--src;
+      /* Copy downward, from the last byte: first the bytes past
+         the last whole word, then the words.  The direction flag
+         must be clear again before returning. */
+      size_t tail = size & 3;
+      size_t words = size / 4;
+
+      dst += size - 1;
+      src += size - 1;
+      asm volatile ("std; rep movsb; cld"
+                    : "+D" (dst), "+S" (src), "+c" (tail) : : "memory");
+      dst -= 3;
+      src -= 3;
+      asm volatile ("std; rep movsl; cld"
+                    : "+D" (dst), "+S" (src), "+c" (words) : : "memory");
     }
 
-  return dst;
+  return dst_;
 }
 
 /* Find the first differing byte in the two blocks of SIZE bytes
@@ -58,6 +105,10 @@ memcmp (const void *a_, const void *b_, size_t size)
   ASSERT (a != NULL || size == 0);
   ASSERT (b != NULL || size == 0);
 
+  /* Skip equal words, then find the differing byte. */
+  for (; size >= 4 && *(const word_t *) a == *(const word_t *) b;
+       a += 4, b += 4, size -= 4)
+    continue;
   for (; size-- > 0; a++, b++)
     if (*a != *b)
       return *a > *b ? +1 : -1;
@@ -98,6 +149,17 @@ memchr (const void *block_, int ch_, size_t size)
 
   ASSERT (block != NULL || size == 0);
 
+  /* Check bytes up to a word boundary, then whole words that
+     lie entirely within the block, then what is left. */
+  for (; size > 0 && (uintptr_t) block % 4 != 0; block++, size--)
+    if (*block == ch)
+      return (void *) block;
+  for (; size >= 4; block += 4, size -= 4)
+    {
+      uint32_t w = *(const word_t *) block ^ (ch * ONES);
+      if (HAS_ZERO_BYTE (w))
+        break;
+    }
   for (; size-- > 0; block++)
     if (*block == ch)
       return (void *) block;
@@ -281,9 +343,21 @@ memset (void *dst_, int value, size_t size)
   unsigned char *dst = dst_;
 
   ASSERT (dst != NULL || size == 0);
-  
-  while (size-- > 0)
-    *dst++ = value;
+
+  if (size >= SMALL)
+    {
+      size_t head = -(uintptr_t) dst & 3;
+      size_t words = (size - head) / 4;
+
+      size -= head + words * 4;
+      asm volatile ("rep stosb"
+                    : "+D" (dst), "+c" (head) : "a" (value) : "memory");
+      asm volatile ("rep stosl"
+                    : "+D" (dst), "+c" (words)
+                    : "a" ((unsigned char) value * ONES) : "memory");
+    }
+  asm volatile ("rep stosb"
+                : "+D" (dst), "+c" (size) : "a" (value) : "memory");
 
   return dst_;
 }
@@ -296,8 +370,15 @@ strlen (const char *string)
 
   ASSERT (string != NULL);
 
-  for (p = string; *p != '\0'; p++)
-    continue;
+  /* Check bytes up to a word boundary, then whole words until
+     one contains a null byte, then find it. */
+  for (p = string; (uintptr_t) p % 4 != 0; p++)
+    if (*p == '\0')
+      return p - string;
+  while (!HAS_ZERO_BYTE (*(const word_t *) p))
+    p += 4;
+  while (*p != '\0')
+    p++;
   return p - string;
 }
 
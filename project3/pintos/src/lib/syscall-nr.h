@@ -28,7 +28,30 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Extensions. */
+    SYS_READV,                  /* Read into several buffers. */
+    SYS_WRITEV,                 /* Write from several buffers. */
+    SYS_PREAD,                  /* Read at a given file offset. */
+    SYS_PWRITE,                 /* Write at a given file offset. */
+    SYS_COPY_FILE_RANGE,        /* Copy between files in the kernel. */
+    SYS_PIPE,                   /* Create a pipe. */
+    SYS_DUP2,                   /* Duplicate a file descriptor. */
+    SYS_SHM_CREATE,             /* Create a shared memory segment. */
+    SYS_SHM_REMOVE,             /* Remove a shared memory segment. */
+    SYS_SHM_ATTACH,             /* Map a shared memory segment. */
+    SYS_SHM_DETACH,             /* Unmap a shared memory segment. */
+    SYS_SBRK,                   /* Grow or shrink the heap. */
+    SYS_MMAP_ANON,              /* Map zeroed anonymous memory. */
+    SYS_MSYNC,                  /* Write back dirty mapped pages. */
+    SYS_MADVISE,                /* Give a memory access hint. */
+    SYS_MLOCK,                  /* Keep pages in memory. */
+    SYS_MUNLOCK,                /* Let locked pages be evicted. */
+    SYS_RING_SETUP,             /* Create an I/O ring. */
+    SYS_RING_ENTER,             /* Carry out I/O ring requests. */
+    SYS_NULL,                   /* Do nothing. */
+    SYS_SYSENTER                /* Tell if sysenter may be used. */
   };
 
 #endif /* lib/syscall-nr.h */
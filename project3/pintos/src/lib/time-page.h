@@ -0,0 +1,30 @@
+#ifndef __LIB_TIME_PAGE_H
+#define __LIB_TIME_PAGE_H
+
+/* Layout of the time page, which the kernel maps read-only into
+   every user process at TIME_PAGE_ADDR so that the process can
+   tell the time without a system call.  See lib/user/clock.h.
+
+   The timer interrupt handler rewrites the page on every tick.
+   It increments `sequence' before and after, so that the
+   sequence is odd while an update is in progress.  A reader
+   copies the fields it needs, then starts over if the sequence
+   was odd or has changed in the meantime. */
+
+#include <stdint.h>
+
+/* User virtual address of the time page: the page just below
+   the lowest address the stack may grow to. */
+#define TIME_PAGE_ADDR ((void *) 0xbf7ff000)
+
+/* The time page. */
+struct time_page
+  {
+    uint32_t sequence;          /* Odd while being updated. */
+    uint32_t ticks_per_sec;     /* Timer interrupts per second. */
+    int64_t ticks;              /* Timer ticks since boot. */
+    uint64_t tsc;               /* Time-stamp counter at the last tick. */
+    uint64_t tsc_per_tick;      /* TSC cycles per tick, or 0 if unknown. */
+  };
+
+#endif /* lib/time-page.h */
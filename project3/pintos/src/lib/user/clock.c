@@ -0,0 +1,60 @@
+#include <clock.h>
+#include <time-page.h>
+
+/* Nanoseconds per second. */
+#define NSEC_PER_SEC 1000000000
+
+/* The kernel's time page.  See lib/time-page.h. */
+static const volatile struct time_page *const time_page = TIME_PAGE_ADDR;
+
+/* Copies the time page into *COPY, retrying until the copy is
+   not torn by a timer interrupt. */
+static void
+read_time_page (struct time_page *copy)
+{
+  uint32_t start;
+
+  do
+    {
+      start = time_page->sequence;
+      copy->ticks_per_sec = time_page->ticks_per_sec;
+      copy->ticks = time_page->ticks;
+      copy->tsc = time_page->tsc;
+      copy->tsc_per_tick = time_page->tsc_per_tick;
+    }
+  while ((start & 1) != 0 || time_page->sequence != start);
+}
+
+/* Returns the number of timer ticks since the OS booted. */
+int64_t
+clock_ticks (void) 
+{
+  struct time_page tp;
+
+  read_time_page (&tp);
+  return tp.ticks;
+}
+
+/* Returns the number of nanoseconds since the OS booted.  The
+   result has tick resolution if the TSC is not calibrated.  The
+   time past the last tick is capped at one tick, so that the
+   result never runs ahead of the next tick and never goes
+   backward. */
+uint64_t
+clock_nsec (void) 
+{
+  struct time_page tp;
+  uint64_t nsec_per_tick, nsec, delta;
+
+  read_time_page (&tp);
+  nsec_per_tick = NSEC_PER_SEC / tp.ticks_per_sec;
+  nsec = tp.ticks * nsec_per_tick;
+  if (tp.tsc_per_tick != 0)
+    {
+      delta = rdtsc () - tp.tsc;
+      if (delta >= tp.tsc_per_tick)
+        delta = tp.tsc_per_tick - 1;
+      nsec += delta * nsec_per_tick / tp.tsc_per_tick;
+    }
+  return nsec;
+}
@@ -0,0 +1,25 @@
+#ifndef __LIB_USER_CLOCK_H
+#define __LIB_USER_CLOCK_H
+
+#include <stdint.h>
+
+/* Time since boot, read from the kernel's time page without a
+   system call.  clock_ticks() counts timer interrupts;
+   clock_nsec() counts nanoseconds, interpolating between ticks
+   with the time-stamp counter when the kernel has calibrated
+   it. */
+int64_t clock_ticks (void);
+uint64_t clock_nsec (void);
+
+/* Returns the processor's time-stamp counter, which counts
+   clock cycles since reset. */
+static inline uint64_t
+rdtsc (void)
+{
+  /* See [IA32-v2b] "RDTSC". */
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+#endif /* lib/user/clock.h */
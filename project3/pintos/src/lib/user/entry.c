@@ -6,5 +6,6 @@ void _start (int argc, char *argv[]);
 void
 _start (int argc, char *argv[]) 
 {
+  syscall_use_sysenter = sysenter_supported ();
   exit (main (argc, argv));
 }
@@ -0,0 +1,395 @@
+#include <stdlib.h>
+#include <debug.h>
+#include <round.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+
+/* A boundary-tag allocator for user programs.
+
+   The heap is the region grown by sbrk().  It is carved into
+   blocks that lie end to end.  Each block starts with a header
+   and ends with a footer, both holding the block's size in bytes
+   (including header and footer) with the low bit set if the
+   block is in use.  The footer lets free() find the block before
+   any block in constant time, so a freed block is always merged
+   with free neighbors on both sides ("coalescing") and two free
+   blocks are never adjacent.
+
+   Free blocks are kept on segregated free lists, one per size
+   class.  Class I holds blocks of 2**(I + 4) up to 2**(I + 5) - 1
+   bytes, except that the last class has no upper bound.
+   malloc() searches the request's own class first fit, then
+   takes the first block of any larger class, since every block
+   there is big enough.  Whatever the block has beyond the
+   request is split off as a new free block if it is big enough
+   to be one.
+
+   If no free block fits, the heap grows by at least
+   HEAP_CHUNK bytes.  When a free block at the end of the heap
+   grows past TRIM_THRESHOLD, all but HEAP_CHUNK of it is given
+   back with a negative sbrk().
+
+   The heap looks like this, where P is an in-use "prologue"
+   block with no payload and E is a zero-size in-use "epilogue"
+   header.  They stop coalescing at the ends without special
+   cases.
+
+        | pad | P hdr | P ftr | block | block | ... | E hdr |
+
+   Payloads are 8-byte aligned.  This allocator is not
+   thread-safe, which is fine because user processes have a
+   single thread. */
+
+/* Block header or footer. */
+typedef uint32_t tag_t;
+
+#define TAG_SIZE sizeof (tag_t)
+#define ALIGNMENT 8                     /* Payload alignment. */
+#define USED 1                          /* In-use bit in a tag. */
+
+/* A free block keeps its free list links in its payload, so no
+   block may be smaller than this. */
+#define MIN_BLOCK 16
+
+/* Number of size classes. */
+#define CLASS_CNT 16
+
+/* Least amount by which to grow the heap. */
+#define HEAP_CHUNK (64 * 1024)
+
+/* A free block this big at the end of the heap is trimmed. */
+#define TRIM_THRESHOLD (4 * HEAP_CHUNK)
+
+/* Largest request we accept, so that sizes cannot overflow. */
+#define MAX_REQUEST (SIZE_MAX / 2)
+
+/* Payload of a free block. */
+struct free_block
+  {
+    struct free_block *prev;    /* Previous in free list. */
+    struct free_block *next;    /* Next in free list. */
+  };
+
+static struct free_block *free_lists[CLASS_CNT];
+static bool heap_ready;
+
+/* Returns the size recorded in TAG. */
+static inline size_t
+tag_size (tag_t tag)
+{
+  return tag & ~(tag_t) (ALIGNMENT - 1);
+}
+
+/* Sets both tags of the block with header HDR. */
+static inline void
+set_tags (tag_t *hdr, size_t size, bool used)
+{
+  tag_t tag = size | (used ? USED : 0);
+  hdr[0] = tag;
+  *(tag_t *) ((uint8_t *) hdr + size - TAG_SIZE) = tag;
+}
+
+/* Returns the header of the block after the one with header
+   HDR. */
+static inline tag_t *
+next_block (tag_t *hdr)
+{
+  return (tag_t *) ((uint8_t *) hdr + tag_size (*hdr));
+}
+
+/* Returns the header of the block before the one with header
+   HDR, found through its footer. */
+static inline tag_t *
+prev_block (tag_t *hdr)
+{
+  return (tag_t *) ((uint8_t *) hdr - tag_size (hdr[-1]));
+}
+
+/* Converts between a block's header and its payload. */
+static inline void *
+hdr_to_payload (tag_t *hdr)
+{
+  return hdr + 1;
+}
+
+static inline tag_t *
+payload_to_hdr (void *p)
+{
+  return (tag_t *) p - 1;
+}
+
+/* Returns the size class for a block of SIZE bytes. */
+static unsigned
+size_class (size_t size)
+{
+  unsigned class = 0;
+
+  for (size >>= 5; size > 0 && class < CLASS_CNT - 1; size >>= 1)
+    class++;
+  return class;
+}
+
+/* Adds free block HDR to its free list. */
+static void
+free_list_push (tag_t *hdr)
+{
+  struct free_block *b = hdr_to_payload (hdr);
+  struct free_block **head = &free_lists[size_class (tag_size (*hdr))];
+
+  b->prev = NULL;
+  b->next = *head;
+  if (*head != NULL)
+    (*head)->prev = b;
+  *head = b;
+}
+
+/* Removes free block HDR from its free list. */
+static void
+free_list_remove (tag_t *hdr)
+{
+  struct free_block *b = hdr_to_payload (hdr);
+
+  if (b->prev != NULL)
+    b->prev->next = b->next;
+  else
+    free_lists[size_class (tag_size (*hdr))] = b->next;
+  if (b->next != NULL)
+    b->next->prev = b->prev;
+}
+
+/* Merges free block HDR, which is on no list, with any free
+   neighbors, and returns the header of the merged block, which
+   is on no list either. */
+static tag_t *
+coalesce (tag_t *hdr)
+{
+  size_t size = tag_size (*hdr);
+  tag_t *next = next_block (hdr);
+
+  if (!(*next & USED))
+    {
+      free_list_remove (next);
+      size += tag_size (*next);
+    }
+  if (!(hdr[-1] & USED))
+    {
+      hdr = prev_block (hdr);
+      free_list_remove (hdr);
+      size += tag_size (*hdr);
+    }
+  set_tags (hdr, size, false);
+  return hdr;
+}
+
+/* Marks block HDR in use with SIZE bytes, giving any excess
+   back to the free lists as a new block. */
+static void
+split (tag_t *hdr, size_t size)
+{
+  size_t excess = tag_size (*hdr) - size;
+
+  if (excess >= MIN_BLOCK)
+    {
+      tag_t *rest;
+
+      set_tags (hdr, size, true);
+      rest = next_block (hdr);
+      set_tags (rest, excess, false);
+      free_list_push (coalesce (rest));
+    }
+  else
+    set_tags (hdr, tag_size (*hdr), true);
+}
+
+/* Creates an empty heap.  Returns true if successful. */
+static bool
+heap_init (void)
+{
+  uintptr_t brk = (uintptr_t) sbrk (0);
+  size_t pad = -brk & (ALIGNMENT - 1);
+  tag_t *p;
+
+  if (sbrk (pad + 4 * TAG_SIZE) == (void *) -1)
+    return false;
+  p = (tag_t *) (brk + pad);
+  p[0] = 0;                                   /* Padding. */
+  set_tags (&p[1], 2 * TAG_SIZE, true);       /* Prologue. */
+  p[3] = 0 | USED;                            /* Epilogue. */
+  heap_ready = true;
+  return true;
+}
+
+/* Grows the heap by at least SIZE bytes.  Returns the header of
+   the free block at its end, which is on no list, or a null
+   pointer if the heap cannot grow. */
+static tag_t *
+extend_heap (size_t size)
+{
+  uint8_t *p;
+  tag_t *hdr;
+
+  size = ROUND_UP (size, HEAP_CHUNK);
+  p = sbrk (size);
+  if (p == (void *) -1)
+    return NULL;
+
+  /* The old epilogue header becomes the new block's header. */
+  hdr = (tag_t *) p - 1;
+  set_tags (hdr, size, false);
+  *next_block (hdr) = 0 | USED;
+  return coalesce (hdr);
+}
+
+/* Returns the header of a free block of at least SIZE bytes,
+   removed from its free list, or a null pointer if there is
+   none. */
+static tag_t *
+find_fit (size_t size)
+{
+  unsigned class = size_class (size);
+  struct free_block *b;
+
+  for (b = free_lists[class]; b != NULL; b = b->next)
+    if (tag_size (*payload_to_hdr (b)) >= size)
+      goto found;
+  for (class++; class < CLASS_CNT; class++)
+    if (free_lists[class] != NULL)
+      {
+        b = free_lists[class];
+        goto found;
+      }
+  return NULL;
+
+ found:
+  free_list_remove (payload_to_hdr (b));
+  return payload_to_hdr (b);
+}
+
+/* Returns the block size needed for a SIZE-byte request. */
+static size_t
+block_size (size_t size)
+{
+  size = ROUND_UP (size + 2 * TAG_SIZE, ALIGNMENT);
+  return size < MIN_BLOCK ? MIN_BLOCK : size;
+}
+
+/* Obtains and returns a new block of at least SIZE bytes.
+   Returns a null pointer if memory is not available. */
+void *
+malloc (size_t size)
+{
+  tag_t *hdr;
+
+  if (size == 0 || size > MAX_REQUEST)
+    return NULL;
+  if (!heap_ready && !heap_init ())
+    return NULL;
+
+  size = block_size (size);
+  hdr = find_fit (size);
+  if (hdr == NULL)
+    {
+      hdr = extend_heap (size);
+      if (hdr == NULL)
+        return NULL;
+    }
+  split (hdr, size);
+  return hdr_to_payload (hdr);
+}
+
+/* Allocates and return A times B bytes initialized to zeroes.
+   Returns a null pointer if memory is not available. */
+void *
+calloc (size_t a, size_t b)
+{
+  void *p;
+  size_t size;
+
+  if (b != 0 && a > SIZE_MAX / b)
+    return NULL;
+  size = a * b;
+
+  p = malloc (size);
+  if (p != NULL)
+    memset (p, 0, size);
+  return p;
+}
+
+/* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
+   moving it in the process.  If successful, returns the new
+   block; on failure, returns a null pointer.  A call with null
+   OLD_BLOCK is equivalent to malloc(NEW_SIZE).  A call with
+   zero NEW_SIZE is equivalent to free(OLD_BLOCK).  The block
+   grows in place if the block after it is free and big
+   enough. */
+void *
+realloc (void *old_block, size_t new_size)
+{
+  tag_t *hdr, *next;
+  size_t size;
+  void *new_block;
+
+  if (old_block == NULL)
+    return malloc (new_size);
+  if (new_size == 0)
+    {
+      free (old_block);
+      return NULL;
+    }
+  if (new_size > MAX_REQUEST)
+    return NULL;
+
+  hdr = payload_to_hdr (old_block);
+  size = block_size (new_size);
+  if (size <= tag_size (*hdr))
+    {
+      split (hdr, size);
+      return old_block;
+    }
+
+  next = next_block (hdr);
+  if (!(*next & USED) && tag_size (*hdr) + tag_size (*next) >= size)
+    {
+      free_list_remove (next);
+      set_tags (hdr, tag_size (*hdr) + tag_size (*next), true);
+      split (hdr, size);
+      return old_block;
+    }
+
+  new_block = malloc (new_size);
+  if (new_block != NULL)
+    {
+      memcpy (new_block, old_block, tag_size (*hdr) - 2 * TAG_SIZE);
+      free (old_block);
+    }
+  return new_block;
+}
+
+/* Frees block P, which must have been previously allocated with
+   malloc(), calloc(), or realloc(). */
+void
+free (void *p)
+{
+  tag_t *hdr;
+  size_t size;
+
+  if (p == NULL)
+    return;
+
+  hdr = payload_to_hdr (p);
+  ASSERT (*hdr & USED);
+  set_tags (hdr, tag_size (*hdr), false);
+  hdr = coalesce (hdr);
+
+  /* Give a large free block at the end of the heap back. */
+  size = tag_size (*hdr);
+  if (*next_block (hdr) == (0 | USED) && size >= TRIM_THRESHOLD
+      && sbrk (-(intptr_t) (size - HEAP_CHUNK)) != (void *) -1)
+    {
+      set_tags (hdr, HEAP_CHUNK, false);
+      *next_block (hdr) = 0 | USED;
+    }
+  free_list_push (hdr);
+}
@@ -0,0 +1,68 @@
+#include <ring.h>
+#include <syscall.h>
+
+/* Sets up RING in the unmapped page at ADDR and locks it in
+   memory, so the kernel never has to fault it back in.  Returns
+   true if successful.  A process may have only one ring. */
+bool
+ring_init (struct ring *ring, void *addr)
+{
+  if (!ring_setup (addr))
+    return false;
+  ring->io = addr;
+
+  /* Failing to lock only costs speed. */
+  mlock (addr, sizeof *ring->io);
+  return true;
+}
+
+/* Adds a request to RING's submission queue for ring_submit() to
+   hand to the kernel.  The arguments that OP does not use are
+   ignored; see enum io_ring_op.  Returns false if the queue is
+   full. */
+bool
+ring_queue (struct ring *ring, enum io_ring_op op, int fd, const void *addr,
+            unsigned len, unsigned offset, uint32_t user_data)
+{
+  struct io_ring *io = ring->io;
+  struct io_ring_sqe *sqe;
+
+  if (io->sq_tail - io->sq_head >= IO_RING_SQ_ENTRIES)
+    return false;
+
+  sqe = &io->sq[io->sq_tail & IO_RING_SQ_MASK];
+  sqe->op = op;
+  sqe->fd = fd;
+  sqe->addr = (uint32_t) addr;
+  sqe->len = len;
+  sqe->offset = offset;
+  sqe->user_data = user_data;
+  io->sq_tail++;
+  return true;
+}
+
+/* Has the kernel carry out every queued request, with a single
+   system call.  Returns the number it consumed, which is less
+   than the number queued only if the completion queue filled up,
+   or -1 on error. */
+int
+ring_submit (struct ring *ring)
+{
+  struct io_ring *io = ring->io;
+
+  return ring_enter (io->sq_tail - io->sq_head);
+}
+
+/* Removes the oldest completion from RING and stores it in
+   *CQE.  Returns false if there is none. */
+bool
+ring_reap (struct ring *ring, struct io_ring_cqe *cqe)
+{
+  struct io_ring *io = ring->io;
+
+  if (io->cq_head == io->cq_tail)
+    return false;
+  *cqe = io->cq[io->cq_head & IO_RING_CQ_MASK];
+  io->cq_head++;
+  return true;
+}
@@ -0,0 +1,23 @@
+#ifndef __LIB_USER_RING_H
+#define __LIB_USER_RING_H
+
+#include <io-ring.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Batches system calls through the kernel's I/O ring: queue any
+   number of requests with ring_queue(), hand them all to the
+   kernel with one ring_submit(), then collect their results with
+   ring_reap(), which returns them in submission order. */
+struct ring
+  {
+    struct io_ring *io;         /* Page shared with the kernel. */
+  };
+
+bool ring_init (struct ring *, void *addr);
+bool ring_queue (struct ring *, enum io_ring_op, int fd, const void *addr,
+                 unsigned len, unsigned offset, uint32_t user_data);
+int ring_submit (struct ring *);
+bool ring_reap (struct ring *, struct io_ring_cqe *);
+
+#endif /* lib/user/ring.h */
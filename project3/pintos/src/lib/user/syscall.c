@@ -1,13 +1,45 @@
 #include <syscall.h>
 #include "../syscall-nr.h"
 
+/* True to enter the kernel with "sysenter", false to use
+   "int $0x30".  Set by _start() if the kernel supports it. */
+bool syscall_use_sysenter;
+
+/* Enters the kernel with "sysenter".  Called with the system
+   call number and its arguments on the stack above the return
+   address, just where "int $0x30" would find them, and returns
+   with the result in %eax and every other register except the
+   flags preserved.
+
+   The kernel returns to the address in %edx with the stack
+   pointer in %ecx, so we save those two registers first.
+   userprog/sysenter-entry.S knows how much we push. */
+asm (".text\n"
+     ".globl syscall_sysenter\n"
+     "syscall_sysenter:\n"
+     "        pushl %ecx\n"
+     "        pushl %edx\n"
+     "        movl %esp, %ecx\n"
+     "        movl $1f, %edx\n"
+     "        sysenter\n"
+     "1:      popl %edx\n"
+     "        popl %ecx\n"
+     "        ret\n");
+
+/* Instructions that carry out a system call whose number and
+   arguments have been pushed on the stack, by whichever path
+   syscall_use_sysenter selects. */
+#define SYSCALL_TRAP                                            \
+        "cmpb $0, syscall_use_sysenter; je 1f; "                \
+        "call syscall_sysenter; jmp 2f; 1: int $0x30; 2: "
+
 /* Invokes syscall NUMBER, passing no arguments, and returns the
    return value as an `int'. */
 #define syscall0(NUMBER)                                        \
         ({                                                      \
           int retval;                                           \
           asm volatile                                          \
-            ("pushl %[number]; int $0x30; addl $4, %%esp"       \
+            ("pushl %[number]; " SYSCALL_TRAP "addl $4, %%esp"  \
                : "=a" (retval)                                  \
                : [number] "i" (NUMBER)                          \
                : "memory");                                     \
@@ -20,7 +52,8 @@
         ({                                                               \
           int retval;                                                    \
           asm volatile                                                   \
-            ("pushl %[arg0]; pushl %[number]; int $0x30; addl $8, %%esp" \
+            ("pushl %[arg0]; pushl %[number]; " SYSCALL_TRAP                 \
+             "addl $8, %%esp"                                            \
                : "=a" (retval)                                           \
                : [number] "i" (NUMBER),                                  \
                  [arg0] "g" (ARG0)                                       \
@@ -35,7 +68,7 @@
           int retval;                                           \
           asm volatile                                          \
             ("pushl %[arg1]; pushl %[arg0]; "                   \
-             "pushl %[number]; int $0x30; addl $12, %%esp"      \
+             "pushl %[number]; " SYSCALL_TRAP "addl $12, %%esp" \
                : "=a" (retval)                                  \
                : [number] "i" (NUMBER),                         \
                  [arg0] "r" (ARG0),                             \
@@ -51,7 +84,7 @@
           int retval;                                           \
           asm volatile                                          \
             ("pushl %[arg2]; pushl %[arg1]; pushl %[arg0]; "    \
-             "pushl %[number]; int $0x30; addl $16, %%esp"      \
+             "pushl %[number]; " SYSCALL_TRAP "addl $16, %%esp" \
                : "=a" (retval)                                  \
                : [number] "i" (NUMBER),                         \
                  [arg0] "r" (ARG0),                             \
@@ -61,6 +94,45 @@
           retval;                                               \
         })
 
+/* Invokes syscall NUMBER, passing arguments ARG0, ARG1, ARG2,
+   and ARG3, and returns the return value as an `int'. */
+#define syscall4(NUMBER, ARG0, ARG1, ARG2, ARG3)                \
+        ({                                                      \
+          int retval;                                           \
+          asm volatile                                          \
+            ("pushl %[arg3]; pushl %[arg2]; pushl %[arg1]; "    \
+             "pushl %[arg0]; pushl %[number]; " SYSCALL_TRAP    \
+             "addl $20, %%esp"                                  \
+               : "=a" (retval)                                  \
+               : [number] "i" (NUMBER),                         \
+                 [arg0] "r" (ARG0),                             \
+                 [arg1] "r" (ARG1),                             \
+                 [arg2] "r" (ARG2),                             \
+                 [arg3] "r" (ARG3)                              \
+               : "memory");                                     \
+          retval;                                               \
+        })
+
+/* Invokes syscall NUMBER, passing arguments ARG0, ARG1, ARG2,
+   ARG3, and ARG4, and returns the return value as an `int'. */
+#define syscall5(NUMBER, ARG0, ARG1, ARG2, ARG3, ARG4)          \
+        ({                                                      \
+          int retval;                                           \
+          asm volatile                                          \
+            ("pushl %[arg4]; pushl %[arg3]; pushl %[arg2]; "    \
+             "pushl %[arg1]; pushl %[arg0]; "                   \
+             "pushl %[number]; " SYSCALL_TRAP "addl $24, %%esp" \
+               : "=a" (retval)                                  \
+               : [number] "i" (NUMBER),                         \
+                 [arg0] "r" (ARG0),                             \
+                 [arg1] "r" (ARG1),                             \
+                 [arg2] "r" (ARG2),                             \
+                 [arg3] "r" (ARG3),                             \
+                 [arg4] "r" (ARG4)                              \
+               : "memory");                                     \
+          retval;                                               \
+        })
+
 void
 halt (void) 
 {
@@ -182,3 +254,131 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+int
+readv (int fd, const struct iovec *iov, int iovcnt)
+{
+  return syscall3 (SYS_READV, fd, iov, iovcnt);
+}
+
+int
+writev (int fd, const struct iovec *iov, int iovcnt)
+{
+  return syscall3 (SYS_WRITEV, fd, iov, iovcnt);
+}
+
+int
+pread (int fd, void *buffer, unsigned size, unsigned offset)
+{
+  return syscall4 (SYS_PREAD, fd, buffer, size, offset);
+}
+
+int
+pwrite (int fd, const void *buffer, unsigned size, unsigned offset)
+{
+  return syscall4 (SYS_PWRITE, fd, buffer, size, offset);
+}
+
+int
+copy_file_range (int in_fd, unsigned in_offset,
+                 int out_fd, unsigned out_offset, unsigned size)
+{
+  return syscall5 (SYS_COPY_FILE_RANGE, in_fd, in_offset,
+                   out_fd, out_offset, size);
+}
+
+bool
+pipe (int fds[2])
+{
+  return syscall1 (SYS_PIPE, fds);
+}
+
+int
+dup2 (int old_fd, int new_fd)
+{
+  return syscall2 (SYS_DUP2, old_fd, new_fd);
+}
+
+bool
+shm_create (int key, unsigned size)
+{
+  return syscall2 (SYS_SHM_CREATE, key, size);
+}
+
+bool
+shm_remove (int key)
+{
+  return syscall1 (SYS_SHM_REMOVE, key);
+}
+
+void *
+shm_attach (int key, void *addr)
+{
+  return (void *) syscall2 (SYS_SHM_ATTACH, key, addr);
+}
+
+bool
+shm_detach (void *addr)
+{
+  return syscall1 (SYS_SHM_DETACH, addr);
+}
+
+void *
+sbrk (intptr_t increment)
+{
+  return (void *) syscall1 (SYS_SBRK, increment);
+}
+
+mapid_t
+mmap_anon (void *addr, size_t size)
+{
+  return syscall2 (SYS_MMAP_ANON, addr, size);
+}
+
+bool
+msync (void *addr, size_t length)
+{
+  return syscall2 (SYS_MSYNC, addr, length);
+}
+
+bool
+madvise (void *addr, size_t length, int advice)
+{
+  return syscall3 (SYS_MADVISE, addr, length, advice);
+}
+
+bool
+mlock (const void *addr, size_t length)
+{
+  return syscall2 (SYS_MLOCK, addr, length);
+}
+
+bool
+munlock (const void *addr, size_t length)
+{
+  return syscall2 (SYS_MUNLOCK, addr, length);
+}
+
+bool
+ring_setup (void *addr)
+{
+  return syscall1 (SYS_RING_SETUP, addr);
+}
+
+int
+ring_enter (unsigned to_submit)
+{
+  return syscall1 (SYS_RING_ENTER, to_submit);
+}
+
+void
+null_syscall (void)
+{
+  syscall0 (SYS_NULL);
+}
+
+bool
+sysenter_supported (void)
+{
+  return syscall0 (SYS_SYSENTER);
+}
@@ -2,6 +2,8 @@
 #define __LIB_USER_SYSCALL_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <debug.h>
 
 /* Process identifier. */
@@ -12,9 +14,26 @@ typedef int pid_t;
 typedef int mapid_t;
 #define MAP_FAILED ((mapid_t) -1)
 
+/* Access pattern hints for madvise(). */
+#define MADV_NORMAL 0           /* Default read-ahead. */
+#define MADV_RANDOM 1           /* No read-ahead. */
+#define MADV_SEQUENTIAL 2       /* Aggressive read-ahead, drop-behind. */
+#define MADV_WILLNEED 3         /* Read in now. */
+#define MADV_DONTNEED 4         /* Discard now; reloaded on next use. */
+
 /* Maximum characters in a filename written by readdir(). */
 #define READDIR_MAX_LEN 14
 
+/* One buffer for readv() or writev(). */
+struct iovec
+  {
+    void *iov_base;             /* Start of buffer. */
+    size_t iov_len;             /* Length of buffer in bytes. */
+  };
+
+/* Most buffers that readv() or writev() accepts in one call. */
+#define IOV_MAX 1024
+
 /* Typical return values from main() and arguments to exit(). */
 #define EXIT_SUCCESS 0          /* Successful execution. */
 #define EXIT_FAILURE 1          /* Unsuccessful execution. */
@@ -45,4 +64,33 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Extensions. */
+int readv (int fd, const struct iovec *, int iovcnt);
+int writev (int fd, const struct iovec *, int iovcnt);
+int pread (int fd, void *buffer, unsigned length, unsigned offset);
+int pwrite (int fd, const void *buffer, unsigned length, unsigned offset);
+int copy_file_range (int in_fd, unsigned in_offset,
+                     int out_fd, unsigned out_offset, unsigned length);
+bool pipe (int fds[2]);
+int dup2 (int old_fd, int new_fd);
+bool shm_create (int key, unsigned size);
+bool shm_remove (int key);
+void *shm_attach (int key, void *addr);
+bool shm_detach (void *addr);
+void *sbrk (intptr_t increment);
+mapid_t mmap_anon (void *addr, size_t size);
+bool msync (void *addr, size_t length);
+bool madvise (void *addr, size_t length, int advice);
+bool mlock (const void *addr, size_t length);
+bool munlock (const void *addr, size_t length);
+bool ring_setup (void *addr);
+int ring_enter (unsigned to_submit);
+void null_syscall (void);
+bool sysenter_supported (void);
+
+/* True if system calls enter the kernel with "sysenter", false
+   if with "int $0x30".  Set at startup when the kernel supports
+   "sysenter"; a program may clear it to use the slower path. */
+extern bool syscall_use_sysenter;
+
 #endif /* lib/user/syscall.h */
@@ -104,6 +104,19 @@ wait_children (pid_t pids[], size_t child_cnt)
     }
 }
 
+/* Creates a file named FILE_NAME of SIZE bytes, failing the
+   test if that cannot be done, and returns a descriptor open on
+   it. */
+int
+create_and_open (const char *file_name, size_t size) 
+{
+  int fd;
+
+  CHECK (create (file_name, size), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  return fd;
+}
+
 void
 check_file_handle (int fd,
                    const char *file_name, const void *buf_, size_t size) 
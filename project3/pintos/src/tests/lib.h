@@ -40,6 +40,8 @@ void shuffle (void *, size_t cnt, size_t size);
 void exec_children (const char *child_name, pid_t pids[], size_t child_cnt);
 void wait_children (pid_t pids[], size_t child_cnt);
 
+int create_and_open (const char *file_name, size_t size);
+
 void check_file_handle (int fd, const char *file_name,
                         const void *buf_, size_t filesize);
 void check_file (const char *file_name, const void *buf, size_t filesize);
@@ -0,0 +1,129 @@
+/* Measures how long a read-mostly workload takes when the
+   shared data is protected by a struct lock versus a struct
+   rwlock, and checks that the readers-writer lock never lets a
+   reader see a write in progress.
+
+   READER_CNT readers and one writer each perform a fixed number
+   of critical sections.  Each critical section busy-waits long
+   enough that threads are regularly preempted while holding the
+   lock, which is when an exclusive lock makes every other
+   reader queue up behind the holder. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define READER_CNT 8            /* Number of reader threads. */
+#define READER_ITERS 50         /* Critical sections per reader. */
+#define WRITER_ITERS 10         /* Critical sections for the writer. */
+#define HOLD_US 2000            /* Busy time inside each section. */
+
+/* Shared state.  The writer keeps FIRST == SECOND outside of its
+   critical sections. */
+static int first, second;
+
+static bool use_rwlock;
+static struct lock lock;
+static struct rwlock rwlock;
+static struct semaphore done;
+
+static thread_func reader_thread;
+static thread_func writer_thread;
+static int64_t run_phase (bool rw);
+
+void
+test_rwlock_contention (void)
+{
+  int64_t lock_ticks, rwlock_ticks;
+
+  lock_init (&lock);
+  rwlock_init (&rwlock);
+  sema_init (&done, 0);
+
+  lock_ticks = run_phase (false);
+  rwlock_ticks = run_phase (true);
+
+  msg ("lock: %lld ticks", lock_ticks);
+  msg ("rwlock: %lld ticks", rwlock_ticks);
+  pass ();
+}
+
+/* Runs all readers and the writer to completion, using the
+   readers-writer lock if RW is true and the plain lock
+   otherwise, and returns the number of ticks they took. */
+static int64_t
+run_phase (bool rw)
+{
+  int64_t start;
+  int i;
+
+  use_rwlock = rw;
+  first = second = 0;
+
+  start = timer_ticks ();
+  for (i = 0; i < READER_CNT; i++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "reader %d", i);
+      thread_create (name, PRI_DEFAULT, reader_thread, NULL);
+    }
+  thread_create ("writer", PRI_DEFAULT, writer_thread, NULL);
+
+  for (i = 0; i < READER_CNT + 1; i++)
+    sema_down (&done);
+  if (first != WRITER_ITERS || second != WRITER_ITERS)
+    fail ("writer updates lost: first=%d, second=%d", first, second);
+  return timer_elapsed (start);
+}
+
+static void
+reader_thread (void *aux UNUSED)
+{
+  int i;
+
+  for (i = 0; i < READER_ITERS; i++)
+    {
+      if (use_rwlock)
+        rwlock_acquire_read (&rwlock);
+      else
+        lock_acquire (&lock);
+
+      if (first != second)
+        fail ("reader saw a write in progress (%d != %d)", first, second);
+      timer_udelay (HOLD_US);
+
+      if (use_rwlock)
+        rwlock_release_read (&rwlock);
+      else
+        lock_release (&lock);
+    }
+  sema_up (&done);
+}
+
+static void
+writer_thread (void *aux UNUSED)
+{
+  int i;
+
+  for (i = 0; i < WRITER_ITERS; i++)
+    {
+      if (use_rwlock)
+        rwlock_acquire_write (&rwlock);
+      else
+        lock_acquire (&lock);
+
+      first++;
+      timer_udelay (HOLD_US);
+      second++;
+
+      if (use_rwlock)
+        rwlock_release_write (&rwlock);
+      else
+        lock_release (&lock);
+      thread_yield ();
+    }
+  sema_up (&done);
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+# One tick count per phase; any value passes.
+fail "missing exclusive lock timing\n"
+  if !grep (/^\(rwlock-contention\) lock: \d+ ticks$/, @output);
+fail "missing readers-writer lock timing\n"
+  if !grep (/^\(rwlock-contention\) rwlock: \d+ ticks$/, @output);
+fail "test did not pass\n"
+  if !grep (/^\(rwlock-contention\) PASS$/, @output);
+pass;
@@ -0,0 +1,53 @@
+/* Measures how fast threads can be created and destroyed.
+
+   The main thread repeatedly creates a batch of BATCH_SIZE
+   threads that exit as soon as they run, then waits for all of
+   them, so that dying threads' pages are recycled while new
+   ones are created, as in a busy exec/exit workload. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 2000         /* Threads created in total. */
+#define BATCH_SIZE 8            /* Threads alive at once, at most. */
+
+static struct semaphore done;
+
+static thread_func exit_thread;
+
+void
+test_spawn_bench (void)
+{
+  int64_t start, ticks;
+  int i, j;
+
+  sema_init (&done, 0);
+
+  start = timer_ticks ();
+  for (i = 0; i < THREAD_CNT; i += BATCH_SIZE)
+    {
+      for (j = 0; j < BATCH_SIZE; j++)
+        if (thread_create ("spawn", PRI_DEFAULT, exit_thread, NULL)
+            == TID_ERROR)
+          fail ("thread_create failed after %d threads", i + j);
+      for (j = 0; j < BATCH_SIZE; j++)
+        sema_down (&done);
+    }
+  ticks = timer_elapsed (start);
+  if (ticks == 0)
+    ticks = 1;
+
+  msg ("%d threads in %lld ticks: %lld threads/s",
+       THREAD_CNT, ticks, THREAD_CNT * TIMER_FREQ / ticks);
+  pass ();
+}
+
+static void
+exit_thread (void *aux UNUSED)
+{
+  sema_up (&done);
+}
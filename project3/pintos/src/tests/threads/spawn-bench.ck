@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+# The rate varies from run to run, so only check that it was
+# reported and that the test passed.
+fail "missing thread creation rate\n"
+  if !grep (/^\(spawn-bench\) \d+ threads in \d+ ticks: \d+ threads\/s$/,
+	    @output);
+fail "test did not pass\n"
+  if !grep (/^\(spawn-bench\) PASS$/, @output);
+pass;
@@ -0,0 +1,214 @@
+/* Measures memcpy(), memset(), memcmp(), and strlen() in cycles
+   per kB, for aligned and misaligned buffers of a few sizes,
+   next to a plain byte-at-a-time loop doing the same work, and
+   checks that each gives the same result as the loop. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/io.h"
+
+#define MAX_SIZE 4096           /* Largest buffer measured. */
+#define REPS 64                 /* Calls timed per measurement. */
+
+static unsigned char src[MAX_SIZE + 8], dst[MAX_SIZE + 8];
+static unsigned char ref[MAX_SIZE + 8];
+
+/* Byte-at-a-time versions, as lib/string.c used to have.  The
+   volatile pointers keep the compiler from turning them back
+   into calls to the functions being measured. */
+static void
+byte_memcpy (void *dst_, const void *src_, size_t size)
+{
+  volatile unsigned char *d = dst_;
+  const unsigned char *s = src_;
+
+  while (size-- > 0)
+    *d++ = *s++;
+}
+
+static void
+byte_memmove (void *dst_, const void *src_, size_t size)
+{
+  volatile unsigned char *d = dst_;
+  const unsigned char *s = src_;
+
+  if (d < s)
+    while (size-- > 0)
+      *d++ = *s++;
+  else
+    while (size-- > 0)
+      d[size] = s[size];
+}
+
+static void
+byte_memset (void *dst_, int value, size_t size)
+{
+  volatile unsigned char *d = dst_;
+
+  while (size-- > 0)
+    *d++ = value;
+}
+
+static int
+byte_memcmp (const void *a_, const void *b_, size_t size)
+{
+  const volatile unsigned char *a = a_;
+  const volatile unsigned char *b = b_;
+
+  for (; size-- > 0; a++, b++)
+    if (*a != *b)
+      return *a > *b ? +1 : -1;
+  return 0;
+}
+
+static size_t
+byte_strlen (const char *s_)
+{
+  const volatile char *s = s_;
+  size_t n = 0;
+
+  while (s[n] != '\0')
+    n++;
+  return n;
+}
+
+/* Which function to time. */
+enum func { MEMCPY, MEMSET, MEMCMP, STRLEN };
+static const char *func_names[] = { "memcpy", "memset", "memcmp", "strlen" };
+
+/* Runs FUNC, or its bytewise version if BYTEWISE, REPS times on
+   SIZE bytes at offset OFS in the buffers, and returns the
+   cycles per kB.  Interrupts are off so that the timer does not
+   land in the middle. */
+static uint64_t
+measure (enum func func, bool bytewise, size_t size, size_t ofs)
+{
+  enum intr_level old_level;
+  uint64_t start, cycles;
+  volatile int sink = 0;
+  int i;
+
+  old_level = intr_disable ();
+  start = rdtsc ();
+  for (i = 0; i < REPS; i++)
+    switch (func)
+      {
+      case MEMCPY:
+        if (bytewise)
+          byte_memcpy (dst + ofs, src + ofs, size);
+        else
+          memcpy (dst + ofs, src + ofs, size);
+        break;
+      case MEMSET:
+        if (bytewise)
+          byte_memset (dst + ofs, i, size);
+        else
+          memset (dst + ofs, i, size);
+        break;
+      case MEMCMP:
+        sink += (bytewise
+                 ? byte_memcmp (dst + ofs, ref + ofs, size)
+                 : memcmp (dst + ofs, ref + ofs, size));
+        break;
+      case STRLEN:
+        sink += (bytewise
+                 ? byte_strlen ((char *) dst + ofs)
+                 : strlen ((char *) dst + ofs));
+        break;
+      }
+  cycles = rdtsc () - start;
+  intr_set_level (old_level);
+
+  return cycles * 1024 / ((uint64_t) REPS * size);
+}
+
+/* Fills DST and REF with the same SIZE nonzero bytes at OFS,
+   followed by a null terminator, for memcmp() and strlen(). */
+static void
+fill_equal (size_t size, size_t ofs)
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    dst[ofs + i] = ref[ofs + i] = 'a' + i % 26;
+  dst[ofs + size] = ref[ofs + size] = '\0';
+}
+
+/* Checks the optimized functions against the bytewise ones for
+   every SIZE up to 64 at every pair of alignments, including
+   overlapping moves in both directions. */
+static void
+check_results (void)
+{
+  size_t size, d, s, i;
+
+  for (i = 0; i < sizeof src; i++)
+    src[i] = i * 7 + 3;
+
+  for (size = 0; size <= 64; size++)
+    for (d = 0; d < 4; d++)
+      for (s = 0; s < 4; s++)
+        {
+          byte_memset (dst, 0, sizeof dst);
+          byte_memset (ref, 0, sizeof ref);
+          memcpy (dst + d, src + s, size);
+          byte_memcpy (ref + d, src + s, size);
+          if (byte_memcmp (dst, ref, sizeof dst))
+            fail ("memcpy wrong for size %zu, alignments %zu, %zu",
+                  size, d, s);
+
+          memmove (dst + d, dst + s, size);
+          byte_memmove (ref + d, ref + s, size);
+          if (byte_memcmp (dst, ref, sizeof dst))
+            fail ("memmove wrong for size %zu, offsets %zu, %zu",
+                  size, d, s);
+
+          memset (dst + s, 0x5a, size);
+          byte_memset (ref + s, 0x5a, size);
+          if (byte_memcmp (dst, ref, sizeof dst))
+            fail ("memset wrong for size %zu, alignment %zu", size, s);
+
+          fill_equal (size, d);
+          if (strlen ((char *) dst + d) != size)
+            fail ("strlen wrong for length %zu, alignment %zu", size, d);
+          if (memcmp (dst + d, ref + d, size) != 0)
+            fail ("memcmp wrong for equal blocks of %zu bytes", size);
+          if (size > 0)
+            {
+              ref[d + size - 1]++;
+              if (memcmp (dst + d, ref + d, size) >= 0)
+                fail ("memcmp wrong for size %zu, alignment %zu", size, d);
+            }
+        }
+}
+
+void
+test_string_bench (void)
+{
+  static const size_t sizes[] = { 64, 512, 4096 };
+  size_t i, ofs;
+  int func;
+
+  check_results ();
+
+  for (func = MEMCPY; func <= STRLEN; func++)
+    for (i = 0; i < sizeof sizes / sizeof *sizes; i++)
+      for (ofs = 0; ofs < 2; ofs++)
+        {
+          uint64_t fast, slow;
+
+          /* Misaligned runs use odd offsets for the destination,
+             and for memcpy() the source too. */
+          if (func == MEMCMP || func == STRLEN)
+            fill_equal (sizes[i], ofs * 3);
+          fast = measure (func, false, sizes[i], ofs * 3);
+          slow = measure (func, true, sizes[i], ofs * 3);
+          msg ("%s %zu %s: %llu cycles/kB, bytewise %llu",
+               func_names[func], sizes[i],
+               ofs ? "misaligned" : "aligned", fast, slow);
+        }
+  pass ();
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+# Each function, size and alignment gets one line.
+foreach my $func (qw (memcpy memset memcmp strlen)) {
+    foreach my $size (64, 512, 4096) {
+	foreach my $align (qw (aligned misaligned)) {
+	    fail "missing $func $size $align timing\n"
+	      if !grep (/^\(string-bench\) $func $size $align: \d+ cycles\/kB, bytewise \d+$/, @output);
+	}
+    }
+}
+fail "test did not pass\n"
+  if !grep (/^\(string-bench\) PASS$/, @output);
+pass;
@@ -38,6 +38,9 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"rwlock-contention", test_rwlock_contention},
+    {"string-bench", test_string_bench},
+    {"spawn-bench", test_spawn_bench},
   };
 
 static const char *test_name;
@@ -0,0 +1,49 @@
+/* Child process run by pipe-bench.
+
+   Reads from the fd given as its first argument and writes to
+   the fd given as its second, both inherited from its parent,
+   after closing the parent's ends of the pipes, given as the
+   third and fourth.  First checks a stream of BULK_SIZE bytes
+   and acknowledges it, then echoes every byte back until end of
+   file. */
+
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/userprog/pipe-bench.h"
+#include "tests/lib.h"
+
+const char *test_name = "child-pipe";
+
+static char buf[4096];
+
+int
+main (int argc, char *argv[]) 
+{
+  int in, out, ofs, n;
+  char c;
+
+  if (argc != 5)
+    fail ("bad command-line arguments");
+  in = atoi (argv[1]);
+  out = atoi (argv[2]);
+  close (atoi (argv[3]));
+  close (atoi (argv[4]));
+
+  for (ofs = 0; ofs < BULK_SIZE; ofs += n)
+    {
+      int i;
+
+      n = read (in, buf, sizeof buf);
+      if (n <= 0)
+        fail ("stream ended at offset %d", ofs);
+      for (i = 0; i < n; i++)
+        if (buf[i] != BULK_BYTE (ofs + i))
+          fail ("stream differs at offset %d", ofs + i);
+    }
+  c = 'k';
+  write (out, &c, 1);
+
+  while ((n = read (in, &c, 1)) == 1)
+    write (out, &c, 1);
+  return n == 0 ? 0 : 1;
+}
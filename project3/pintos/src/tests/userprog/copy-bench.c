@@ -0,0 +1,82 @@
+/* Copies a large file twice, once through a user buffer with
+   read() and write() as "cp" used to, and once with
+   copy_file_range(), reporting the time each copy took and
+   checking that both copies match the original. */
+
+#include <clock.h>
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE (128 * 1024)
+
+static char buf[4096];
+
+/* Checks that NAME holds the pattern written by test_main(). */
+static void
+verify (const char *name)
+{
+  int fd, ofs;
+
+  CHECK ((fd = open (name)) > 1, "open \"%s\" for verification", name);
+  for (ofs = 0; ofs < FILE_SIZE; ofs += sizeof buf)
+    {
+      size_t i;
+
+      if (read (fd, buf, sizeof buf) != (int) sizeof buf)
+        fail ("read of \"%s\" failed at offset %d", name, ofs);
+      for (i = 0; i < sizeof buf; i++)
+        if (buf[i] != (char) ((ofs + i) * 7))
+          fail ("\"%s\" differs at offset %zu", name, ofs + i);
+    }
+  close (fd);
+}
+
+void
+test_main (void) 
+{
+  uint64_t start, buffered, in_kernel;
+  int src, dst, ofs;
+  size_t i;
+
+  src = create_and_open ("source", FILE_SIZE);
+  for (ofs = 0; ofs < FILE_SIZE; ofs += sizeof buf)
+    {
+      for (i = 0; i < sizeof buf; i++)
+        buf[i] = (ofs + i) * 7;
+      if (write (src, buf, sizeof buf) != (int) sizeof buf)
+        fail ("write to \"source\" failed");
+    }
+
+  /* Copy through a user buffer, as cp did. */
+  dst = create_and_open ("buffered", FILE_SIZE);
+  seek (src, 0);
+  start = rdtsc ();
+  for (ofs = 0; ofs < FILE_SIZE; ofs += 1024)
+    if (read (src, buf, 1024) != 1024 || write (dst, buf, 1024) != 1024)
+      fail ("buffered copy failed at offset %d", ofs);
+  buffered = rdtsc () - start;
+  close (dst);
+
+  /* Copy inside the kernel. */
+  dst = create_and_open ("in-kernel", FILE_SIZE);
+  start = rdtsc ();
+  for (ofs = 0; ofs < FILE_SIZE; )
+    {
+      int n = copy_file_range (src, ofs, dst, ofs, FILE_SIZE - ofs);
+      if (n <= 0)
+        fail ("copy_file_range failed at offset %d", ofs);
+      ofs += n;
+    }
+  in_kernel = rdtsc () - start;
+  close (dst);
+  close (src);
+
+  verify ("buffered");
+  verify ("in-kernel");
+
+  msg ("read/write: %llu kcycles", buffered / 1000);
+  msg ("copy_file_range: %llu kcycles", in_kernel / 1000);
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+# The cycle counts are for reading, not checking.
+foreach my $how ('read/write', 'copy_file_range') {
+    fail "missing $how timing\n"
+      if !grep (/^\(copy-bench\) $how: \d+ kcycles$/, @output);
+}
+fail "test did not end\n"
+  if !grep (/^\(copy-bench\) end$/, @output);
+fail "test did not exit cleanly\n"
+  if !grep (/^copy-bench: exit\(0\)$/, @output);
+pass;
@@ -0,0 +1,70 @@
+/* Measures pipe throughput and round-trip latency between this
+   process and child-pipe, which inherits the pipe ends across
+   exec().  Streams BULK_SIZE bytes to the child, which checks
+   them and acknowledges with one byte, then bounces one byte
+   back and forth PING_CNT times.  Closing the write end then
+   lets the child see end of file and exit. */
+
+#include <clock.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/userprog/pipe-bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PING_CNT 1000
+
+static char buf[4096];
+
+void
+test_main (void) 
+{
+  char child_cmd[128];
+  int to_child[2], from_child[2];
+  uint64_t start, bulk, ping;
+  pid_t pid;
+  char c;
+  int ofs, i;
+
+  CHECK (pipe (to_child), "pipe to child");
+  CHECK (pipe (from_child), "pipe from child");
+  snprintf (child_cmd, sizeof child_cmd, "child-pipe %d %d %d %d",
+            to_child[0], from_child[1], to_child[1], from_child[0]);
+  CHECK ((pid = exec (child_cmd)) != PID_ERROR, "exec child-pipe");
+  close (to_child[0]);
+  close (from_child[1]);
+
+  /* Stream. */
+  start = rdtsc ();
+  for (ofs = 0; ofs < BULK_SIZE; ofs += sizeof buf)
+    {
+      size_t j;
+
+      for (j = 0; j < sizeof buf; j++)
+        buf[j] = BULK_BYTE (ofs + j);
+      if (write (to_child[1], buf, sizeof buf) != (int) sizeof buf)
+        fail ("write to pipe failed at offset %d", ofs);
+    }
+  if (read (from_child[0], &c, 1) != 1 || c != 'k')
+    fail ("child did not receive the stream intact");
+  bulk = rdtsc () - start;
+
+  /* Ping-pong. */
+  start = rdtsc ();
+  for (i = 0; i < PING_CNT; i++)
+    {
+      c = i;
+      if (write (to_child[1], &c, 1) != 1
+          || read (from_child[0], &c, 1) != 1 || c != (char) i)
+        fail ("round trip %d failed", i);
+    }
+  ping = rdtsc () - start;
+
+  close (to_child[1]);
+  CHECK (read (from_child[0], &c, 1) == 0, "end of file from child");
+  CHECK (wait (pid) == 0, "wait for child-pipe");
+
+  msg ("stream: %d kB in %llu kcycles", BULK_SIZE / 1024, bulk / 1000);
+  msg ("round trip: %llu cycles", ping / PING_CNT);
+}
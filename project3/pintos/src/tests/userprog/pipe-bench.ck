@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+# Both measurements must appear; their values are not checked.
+fail "missing stream timing\n"
+  if !grep (/^\(pipe-bench\) stream: \d+ kB in \d+ kcycles$/, @output);
+fail "missing round trip timing\n"
+  if !grep (/^\(pipe-bench\) round trip: \d+ cycles$/, @output);
+fail "child did not exit cleanly\n"
+  if !grep (/^\(pipe-bench\) wait for child-pipe$/, @output)
+     || !grep (/^child-pipe: exit\(0\)$/, @output);
+fail "test did not exit cleanly\n"
+  if !grep (/^pipe-bench: exit\(0\)$/, @output);
+pass;
@@ -0,0 +1,10 @@
+#ifndef TESTS_USERPROG_PIPE_BENCH_H
+#define TESTS_USERPROG_PIPE_BENCH_H
+
+/* Bytes the pipe-bench test streams to child-pipe. */
+#define BULK_SIZE (256 * 1024)
+
+/* Returns the byte at offset OFS of the stream. */
+#define BULK_BYTE(OFS) ((char) ((OFS) * 7 + 3))
+
+#endif /* tests/userprog/pipe-bench.h */
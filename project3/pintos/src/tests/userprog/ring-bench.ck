@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+# Every transfer must report a cycle count.
+foreach my $how ('syscall write', 'ring write', 'syscall read',
+		 'ring read') {
+    fail "missing $how timing\n"
+      if !grep (/^\(ring-bench\) $how: \d+ kcycles$/, @output);
+}
+fail "test did not end\n"
+  if !grep (/^\(ring-bench\) end$/, @output);
+fail "test did not exit cleanly\n"
+  if !grep (/^ring-bench: exit\(0\)$/, @output);
+pass;
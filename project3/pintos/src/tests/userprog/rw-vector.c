@@ -0,0 +1,52 @@
+/* Writes a file with writev(), overwrites part of it with
+   pwrite(), and reads it back with pread() and readv(), checking
+   that the positional calls leave the file position alone. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char header[] = "header:";
+static char payload[] = "the quick brown fox";
+
+void
+test_main (void) 
+{
+  struct iovec iov[2];
+  char head_buf[sizeof header - 1];
+  char body_buf[sizeof payload - 1];
+  char word[5];
+  size_t total = sizeof header - 1 + sizeof payload - 1;
+  int fd;
+
+  /* Files cannot grow, so create it at its final size. */
+  CHECK (create ("data", total), "create \"data\"");
+  CHECK ((fd = open ("data")) > 1, "open \"data\"");
+
+  iov[0].iov_base = header;
+  iov[0].iov_len = sizeof header - 1;
+  iov[1].iov_base = payload;
+  iov[1].iov_len = sizeof payload - 1;
+  CHECK (writev (fd, iov, 2) == (int) total, "writev header and payload");
+  CHECK (tell (fd) == total, "tell after writev");
+
+  CHECK (pwrite (fd, "slow ", 5, 11) == 5, "pwrite at offset 11");
+  CHECK (pread (fd, word, 5, 11) == 5, "pread at offset 11");
+  if (memcmp (word, "slow ", 5))
+    fail ("pread returned the wrong bytes");
+  CHECK (tell (fd) == total, "tell after pread and pwrite");
+
+  seek (fd, 0);
+  iov[0].iov_base = head_buf;
+  iov[0].iov_len = sizeof head_buf;
+  iov[1].iov_base = body_buf;
+  iov[1].iov_len = sizeof body_buf;
+  CHECK (readv (fd, iov, 2) == (int) total, "readv header and payload");
+  compare_bytes (head_buf, header, sizeof head_buf, 0, "data");
+  memcpy (payload + 4, "slow ", 5);
+  compare_bytes (body_buf, payload, sizeof body_buf, sizeof head_buf, "data");
+
+  CHECK (pread (fd, word, 5, total) == 0, "pread at end of file");
+  close (fd);
+}
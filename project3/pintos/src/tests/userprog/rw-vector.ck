@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rw-vector) begin
+(rw-vector) create "data"
+(rw-vector) open "data"
+(rw-vector) writev header and payload
+(rw-vector) tell after writev
+(rw-vector) pwrite at offset 11
+(rw-vector) pread at offset 11
+(rw-vector) tell after pread and pwrite
+(rw-vector) readv header and payload
+(rw-vector) pread at end of file
+(rw-vector) end
+rw-vector: exit(0)
+EOF
+pass;
@@ -0,0 +1,41 @@
+/* Times a system call that does nothing, entered once with
+   "int $0x30" and once with "sysenter", if the kernel supports
+   it. */
+
+#include <clock.h>
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CALL_CNT 10000
+
+/* Returns the average cycles per null system call, entered with
+   "sysenter" if USE_SYSENTER is true, otherwise with
+   "int $0x30". */
+static unsigned
+time_null_syscall (bool use_sysenter)
+{
+  uint64_t start;
+  int i;
+
+  syscall_use_sysenter = use_sysenter;
+  start = rdtsc ();
+  for (i = 0; i < CALL_CNT; i++)
+    null_syscall ();
+  return (rdtsc () - start) / CALL_CNT;
+}
+
+void
+test_main (void) 
+{
+  bool fast = syscall_use_sysenter;
+
+  CHECK (fast == sysenter_supported (), "sysenter flag matches kernel");
+  msg ("int $0x30: %u cycles", time_null_syscall (false));
+  if (fast)
+    msg ("sysenter: %u cycles", time_null_syscall (true));
+  else
+    msg ("sysenter: not supported");
+  syscall_use_sysenter = fast;
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+# The sysenter line may say it is not supported; either form
+# passes.
+fail "missing int \$0x30 timing\n"
+  if !grep (/^\(syscall-bench\) int \$0x30: \d+ cycles$/, @output);
+fail "missing sysenter timing\n"
+  if !grep (/^\(syscall-bench\) sysenter: (\d+ cycles|not supported)$/,
+	    @output);
+fail "test did not end\n"
+  if !grep (/^\(syscall-bench\) end$/, @output);
+fail "test did not exit cleanly\n"
+  if !grep (/^syscall-bench: exit\(0\)$/, @output);
+pass;
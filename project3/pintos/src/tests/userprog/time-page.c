@@ -0,0 +1,37 @@
+/* Reads the time from the kernel's time page, checking that it
+   advances and never goes backward, then tries to write the
+   page, which must kill the process. */
+
+#include <clock.h>
+#include <time-page.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Reads of the clock to allow for one tick to pass. */
+#define READ_CNT 100000000
+
+void
+test_main (void) 
+{
+  int64_t start, ticks;
+  uint64_t nsec, prev;
+  int i;
+
+  start = clock_ticks ();
+  prev = clock_nsec ();
+  for (i = 0; i < READ_CNT; i++)
+    {
+      ticks = clock_ticks ();
+      nsec = clock_nsec ();
+      if (nsec < prev)
+        fail ("clock_nsec went backward from %llu to %llu", prev, nsec);
+      prev = nsec;
+      if (ticks != start)
+        break;
+    }
+  CHECK (i < READ_CNT, "clock ticks advance");
+
+  msg ("write time page");
+  *(volatile int64_t *) TIME_PAGE_ADDR = 0;
+  fail ("should have exited with -1");
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_USER_FAULTS => 1, [<<'EOF']);
+(time-page) begin
+(time-page) clock ticks advance
+(time-page) write time page
+time-page: exit(-1)
+EOF
+pass;
@@ -0,0 +1,25 @@
+/* Child process for shm-share test.
+   Attaches the parent's segment at a different address, checks
+   the parent's data, and inverts the second page. */
+
+#include <syscall.h>
+#include "tests/vm/shm-share.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  char *shared = (char *) 0x12345000;
+  size_t i;
+
+  if (shm_attach (SHM_KEY, shared) != shared)
+    fail ("attach segment");
+  for (i = 0; i < SHM_SIZE; i++)
+    if (shared[i] != (char) (i % 251))
+      fail ("byte %zu differs from parent's", i);
+  for (i = SHM_SIZE / 2; i < SHM_SIZE; i++)
+    shared[i] = ~(i % 251);
+  if (!shm_detach (shared))
+    fail ("detach segment");
+}
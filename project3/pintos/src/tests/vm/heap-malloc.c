@@ -0,0 +1,99 @@
+/* Moves the end of the heap with sbrk(), then allocates,
+   resizes, and frees many blocks of random sizes with malloc()
+   and realloc(), checking that no block's contents are
+   disturbed by the others.  Finally checks that freed memory
+   coalesces into a block big enough for one large request. */
+
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/arc4.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define BLOCK_CNT 512
+#define ROUND_CNT 8192
+
+static char *blocks[BLOCK_CNT];
+static size_t sizes[BLOCK_CNT];
+
+static unsigned
+random_uint (struct arc4 *arc4) 
+{
+  unsigned r = 0;
+  arc4_crypt (arc4, &r, sizeof r);
+  return r;
+}
+
+/* Returns a random size, mostly small but sometimes up to
+   16 kB. */
+static size_t
+random_size (struct arc4 *arc4) 
+{
+  unsigned r = random_uint (arc4);
+  return r % (r & 7 ? 128 : 16384) + 1;
+}
+
+static void
+verify (size_t i) 
+{
+  size_t j;
+
+  for (j = 0; j < sizes[i]; j++)
+    if (blocks[i][j] != (char) i)
+      fail ("block %zu corrupted at byte %zu of %zu", i, j, sizes[i]);
+}
+
+void
+test_main (void) 
+{
+  struct arc4 arc4;
+  char *brk, *p;
+  size_t i, round;
+
+  brk = sbrk (0);
+  CHECK ((p = sbrk (8192)) == brk, "sbrk 8192");
+  memset (p, 0xcc, 8192);
+  CHECK (sbrk (-8192) == brk + 8192, "sbrk -8192");
+  CHECK (sbrk (0x7fffffff) == (void *) -1, "sbrk too far (must fail)");
+
+  arc4_init (&arc4, "heap-malloc", 11);
+  for (round = 0; round < ROUND_CNT; round++) 
+    {
+      i = random_uint (&arc4) % BLOCK_CNT;
+      if (blocks[i] != NULL) 
+        {
+          verify (i);
+          if (random_uint (&arc4) & 1) 
+            {
+              free (blocks[i]);
+              blocks[i] = NULL;
+              continue;
+            }
+        }
+      sizes[i] = random_size (&arc4);
+      blocks[i] = realloc (blocks[i], sizes[i]);
+      if (blocks[i] == NULL)
+        fail ("realloc of %zu bytes failed", sizes[i]);
+      memset (blocks[i], i, sizes[i]);
+    }
+  msg ("random malloc, realloc, and free");
+
+  for (i = 0; i < BLOCK_CNT; i++)
+    if (blocks[i] != NULL) 
+      {
+        verify (i);
+        free (blocks[i]);
+      }
+  msg ("blocks intact");
+
+  CHECK ((p = malloc (1024 * 1024)) != NULL, "malloc 1 MB");
+  memset (p, 0x33, 1024 * 1024);
+  free (p);
+
+  CHECK ((p = calloc (1000, 100)) != NULL, "calloc 100000 bytes");
+  for (i = 0; i < 1000 * 100; i++)
+    if (p[i] != 0)
+      fail ("calloc'd byte %zu is not zero", i);
+  free (p);
+}
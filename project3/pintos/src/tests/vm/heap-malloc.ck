@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(heap-malloc) begin
+(heap-malloc) sbrk 8192
+(heap-malloc) sbrk -8192
+(heap-malloc) sbrk too far (must fail)
+(heap-malloc) random malloc, realloc, and free
+(heap-malloc) blocks intact
+(heap-malloc) malloc 1 MB
+(heap-malloc) calloc 100000 bytes
+(heap-malloc) end
+EOF
+pass;
@@ -0,0 +1,78 @@
+/* Maps a 16-page file and scans it under each madvise() hint,
+   checking that the hints never change what is read.  Then
+   writes to the mapping and checks that msync() writes the
+   change to the file and that MADV_DONTNEED does not lose
+   it. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_CNT 16
+#define SIZE (PAGE_CNT * 4096)
+
+static char buf[4096];
+
+/* Returns the byte expected at OFS in the file. */
+static char
+expected (size_t ofs) 
+{
+  return ofs * 7 / 4096 + ofs % 251;
+}
+
+static void
+scan (const char *data, const char *hint) 
+{
+  size_t i;
+
+  for (i = 0; i < SIZE; i++)
+    if (data[i] != expected (i))
+      fail ("byte %zu is wrong after %s", i, hint);
+  msg ("scan after %s", hint);
+}
+
+void
+test_main (void) 
+{
+  char *data = (char *) 0x10000000;
+  int handle;
+  mapid_t map;
+  size_t i, j;
+
+  CHECK (create ("advise", SIZE), "create \"advise\"");
+  CHECK ((handle = open ("advise")) > 1, "open \"advise\"");
+  for (i = 0; i < PAGE_CNT; i++) 
+    {
+      for (j = 0; j < sizeof buf; j++)
+        buf[j] = expected (i * 4096 + j);
+      if (write (handle, buf, sizeof buf) != sizeof buf)
+        fail ("write page %zu", i);
+    }
+  CHECK ((map = mmap (handle, data)) != MAP_FAILED, "mmap \"advise\"");
+
+  CHECK (madvise (data, SIZE, MADV_SEQUENTIAL), "madvise sequential");
+  scan (data, "MADV_SEQUENTIAL");
+  CHECK (madvise (data, SIZE, MADV_RANDOM), "madvise random");
+  scan (data, "MADV_RANDOM");
+  CHECK (madvise (data, SIZE, MADV_WILLNEED), "madvise willneed");
+  scan (data, "MADV_WILLNEED");
+  CHECK (!madvise (data, SIZE, 99), "madvise bad hint (must fail)");
+  CHECK (!madvise (data + 1, 4096, MADV_NORMAL),
+         "madvise misaligned (must fail)");
+
+  data[3 * 4096 + 5] = 'x';
+  CHECK (msync (data + 3 * 4096, 4096), "msync page 3");
+  seek (handle, 3 * 4096);
+  CHECK (read (handle, buf, sizeof buf) == sizeof buf, "read page 3");
+  if (buf[5] != 'x')
+    fail ("msync did not write page 3 to the file");
+
+  data[7 * 4096] = 'y';
+  CHECK (madvise (data, SIZE, MADV_DONTNEED), "madvise dontneed");
+  if (data[3 * 4096 + 5] != 'x' || data[7 * 4096] != 'y')
+    fail ("MADV_DONTNEED lost a write");
+  msg ("writes kept after MADV_DONTNEED");
+
+  munmap (map);
+}
@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-advise) begin
+(mmap-advise) create "advise"
+(mmap-advise) open "advise"
+(mmap-advise) mmap "advise"
+(mmap-advise) madvise sequential
+(mmap-advise) scan after MADV_SEQUENTIAL
+(mmap-advise) madvise random
+(mmap-advise) scan after MADV_RANDOM
+(mmap-advise) madvise willneed
+(mmap-advise) scan after MADV_WILLNEED
+(mmap-advise) madvise bad hint (must fail)
+(mmap-advise) madvise misaligned (must fail)
+(mmap-advise) msync page 3
+(mmap-advise) read page 3
+(mmap-advise) madvise dontneed
+(mmap-advise) writes kept after MADV_DONTNEED
+(mmap-advise) end
+EOF
+pass;
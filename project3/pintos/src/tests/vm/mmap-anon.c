@@ -0,0 +1,45 @@
+/* Maps anonymous memory and checks that it reads as zeros, keeps
+   what is written to it, cannot be mapped over, and is zeroed
+   again after being unmapped and mapped a second time. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_CNT 3
+#define SIZE (PAGE_CNT * 4096 - 100)
+
+static void
+check_bytes (const char *data, char value) 
+{
+  size_t i;
+
+  /* The size is rounded up to whole pages, so check those too. */
+  for (i = 0; i < PAGE_CNT * 4096; i++)
+    if (data[i] != value)
+      fail ("byte %zu is %d, not %d", i, data[i], value);
+}
+
+void
+test_main (void) 
+{
+  char *data = (char *) 0x10000000;
+  mapid_t map;
+
+  CHECK ((map = mmap_anon (data, SIZE)) != MAP_FAILED, "mmap_anon");
+  check_bytes (data, 0);
+  msg ("mapping is zeroed");
+
+  memset (data, 0x5a, PAGE_CNT * 4096);
+  CHECK (mmap_anon (data + 4096, 4096) == MAP_FAILED,
+         "mmap_anon over mapping (must fail)");
+  check_bytes (data, 0x5a);
+  msg ("mapping kept data");
+
+  munmap (map);
+  CHECK ((map = mmap_anon (data, SIZE)) != MAP_FAILED, "mmap_anon again");
+  check_bytes (data, 0);
+  msg ("new mapping is zeroed");
+  munmap (map);
+}
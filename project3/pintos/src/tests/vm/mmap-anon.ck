@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-anon) begin
+(mmap-anon) mmap_anon
+(mmap-anon) mapping is zeroed
+(mmap-anon) mmap_anon over mapping (must fail)
+(mmap-anon) mapping kept data
+(mmap-anon) mmap_anon again
+(mmap-anon) new mapping is zeroed
+(mmap-anon) end
+EOF
+pass;
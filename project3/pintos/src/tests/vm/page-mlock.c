@@ -0,0 +1,45 @@
+/* Locks part of a large buffer, streams through a much larger
+   one to push pages out, and checks that the locked data
+   survived.  The .ck file checks from the kernel's frame
+   statistics that eviction passed over the locked frames.  Also
+   checks mlock()'s error cases, including the per-process
+   limit. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define HOT_SIZE (8 * 4096)
+#define COLD_SIZE (2 * 1024 * 1024)
+#define LIMIT_SIZE (64 * 4096)
+
+static char hot[HOT_SIZE];
+static char cold[COLD_SIZE];
+static char too_big[LIMIT_SIZE];
+
+void
+test_main (void) 
+{
+  size_t i;
+
+  CHECK (mlock (hot, sizeof hot), "mlock hot buffer");
+  CHECK (mlock (hot + 100, 200), "mlock part of it again");
+  memset (hot, 0x5a, sizeof hot);
+
+  for (i = 0; i < sizeof cold; i += 512)
+    cold[i] = i;
+  msg ("stream through cold buffer");
+
+  for (i = 0; i < sizeof hot; i++)
+    if (hot[i] != 0x5a)
+      fail ("locked byte %zu changed", i);
+  msg ("locked buffer intact");
+
+  CHECK (!mlock (too_big, sizeof too_big), "mlock past limit (must fail)");
+  CHECK (!mlock ((void *) 0x20000000, 4096),
+         "mlock unmapped memory (must fail)");
+  CHECK (munlock (hot, sizeof hot), "munlock hot buffer");
+  CHECK (mlock (too_big, 16 * 4096), "mlock within limit after munlock");
+  CHECK (munlock (too_big, 16 * 4096), "munlock");
+}
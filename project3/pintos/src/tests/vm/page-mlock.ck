@@ -0,0 +1,31 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-mlock) begin
+(page-mlock) mlock hot buffer
+(page-mlock) mlock part of it again
+(page-mlock) stream through cold buffer
+(page-mlock) locked buffer intact
+(page-mlock) mlock past limit (must fail)
+(page-mlock) mlock unmapped memory (must fail)
+(page-mlock) munlock hot buffer
+(page-mlock) mlock within limit after munlock
+(page-mlock) munlock
+(page-mlock) end
+EOF
+
+# Swap would keep the hot buffer intact even if mlock() did
+# nothing, so also check that the clock met the locked frames
+# while the cold buffer pushed other pages out, and passed them
+# over.
+our ($test);
+my ($frame) = grep (/^Frame: /, read_text_file ("$test.output"));
+fail "missing frame statistics\n" if !defined $frame;
+my ($evictions, $skipped)
+  = $frame =~ /^Frame: (\d+) evictions, (\d+) locked frames skipped,/
+  or fail "malformed frame statistics: $frame\n";
+fail "cold buffer evicted nothing\n" if $evictions == 0;
+fail "eviction never passed over a locked frame\n" if $skipped == 0;
+pass;
@@ -0,0 +1,35 @@
+/* Attaches a shared memory segment larger than the user pool
+   and writes, then checks, every page of it, so that loading
+   shared pages has to evict other shared pages. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SHM_KEY 0x5345
+#define SIZE (2 * 1024 * 1024)
+#define PAGE_SIZE 4096
+
+void
+test_main (void)
+{
+  char *shared = (char *) 0x54321000;
+  size_t i;
+
+  CHECK (shm_create (SHM_KEY, SIZE), "create 2 MB segment");
+  CHECK (shm_attach (SHM_KEY, shared) == shared, "attach segment");
+
+  msg ("write pass");
+  for (i = 0; i < SIZE; i += PAGE_SIZE)
+    memset (shared + i, (i / PAGE_SIZE) % 251, PAGE_SIZE);
+
+  msg ("read pass");
+  for (i = 0; i < SIZE; i++)
+    if (shared[i] != (char) ((i / PAGE_SIZE) % 251))
+      fail ("byte %zu is %d, expected %d", i, shared[i],
+            (char) ((i / PAGE_SIZE) % 251));
+
+  CHECK (shm_detach (shared), "detach segment");
+  CHECK (shm_remove (SHM_KEY), "remove segment");
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(shm-evict) begin
+(shm-evict) create 2 MB segment
+(shm-evict) attach segment
+(shm-evict) write pass
+(shm-evict) read pass
+(shm-evict) detach segment
+(shm-evict) remove segment
+(shm-evict) end
+EOF
+pass;
@@ -0,0 +1,39 @@
+/* Creates a shared memory segment, fills it, and runs child-shm,
+   which attaches the same segment at a different address, checks
+   the data, and writes a reply that the parent must then see. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/shm-share.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  char *shared = (char *) 0x54321000;
+  pid_t child;
+  size_t i;
+
+  CHECK (shm_create (SHM_KEY, SHM_SIZE), "create segment");
+  CHECK (!shm_create (SHM_KEY, SHM_SIZE), "create segment again (must fail)");
+  CHECK (shm_attach (SHM_KEY, shared) == shared, "attach segment");
+  for (i = 0; i < SHM_SIZE; i++)
+    shared[i] = i % 251;
+
+  CHECK ((child = exec ("child-shm")) != -1, "exec \"child-shm\"");
+  CHECK (wait (child) == 0, "wait for child");
+
+  for (i = 0; i < SHM_SIZE / 2; i++)
+    if (shared[i] != (char) (i % 251))
+      fail ("byte %zu changed in first page", i);
+  for (i = SHM_SIZE / 2; i < SHM_SIZE; i++)
+    if (shared[i] != (char) ~(i % 251))
+      fail ("child's write of byte %zu not visible", i);
+  msg ("child's writes are visible");
+
+  CHECK (shm_detach (shared), "detach segment");
+  CHECK (shm_remove (SHM_KEY), "remove segment");
+  CHECK (shm_attach (SHM_KEY, shared) == NULL,
+         "attach removed segment (must fail)");
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(shm-share) begin
+(shm-share) create segment
+(shm-share) create segment again (must fail)
+(shm-share) attach segment
+(shm-share) exec "child-shm"
+(child-shm) begin
+(child-shm) end
+child-shm: exit(0)
+(shm-share) wait for child
+(shm-share) child's writes are visible
+(shm-share) detach segment
+(shm-share) remove segment
+(shm-share) attach removed segment (must fail)
+(shm-share) end
+shm-share: exit(0)
+EOF
+pass;
@@ -0,0 +1,8 @@
+#ifndef TESTS_VM_SHM_SHARE_H
+#define TESTS_VM_SHM_SHARE_H
+
+/* Shared by shm-share and child-shm. */
+#define SHM_KEY 0x5348
+#define SHM_SIZE (2 * 4096)
+
+#endif /* tests/vm/shm-share.h */
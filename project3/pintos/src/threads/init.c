@@ -20,8 +20,12 @@
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/profile.h"
+#include "threads/trace.h"
 #include "threads/pte.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
+#include "vm/shm.h"
 #include "vm/swap.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -35,6 +39,8 @@
 #ifdef FILESYS
 #include "devices/block.h"
 #include "devices/ide.h"
+#include "devices/ramdisk.h"
+#include "devices/virtio-blk.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #endif
@@ -58,6 +64,9 @@ static const char *swap_bdev_name;
 /* -ul: Maximum number of pages to put into palloc's user pool. */
 static size_t user_page_limit = SIZE_MAX;
 
+/* -trace: Size of the trace ring in pages, 0 for the default. */
+static size_t trace_page_cnt;
+
 static void bss_init (void);
 static void paging_init (void);
 
@@ -99,6 +108,8 @@ main (void)
   palloc_init (user_page_limit);
   malloc_init ();
   paging_init ();
+  profile_init ();
+  trace_init (trace_page_cnt);
 
   /* Segmentation. */
 #ifdef USERPROG
@@ -115,6 +126,9 @@ main (void)
   exception_init ();
   syscall_init ();
 #endif
+#ifdef VM
+  shm_init ();
+#endif
 
   /* Start thread scheduler and enable interrupts. */
   thread_start ();
@@ -124,6 +138,8 @@ main (void)
 #ifdef FILESYS
   /* Initialize file system. */
   ide_init ();
+  virtio_blk_init ();
+  ramdisk_init ();
   locate_block_devices ();
   filesys_init (format_filesys);
 #endif
@@ -248,6 +264,10 @@ parse_options (char **argv)
         filesys_bdev_name = value;
       else if (!strcmp (name, "-scratch"))
         scratch_bdev_name = value;
+      else if (!strcmp (name, "-nodma"))
+        ide_use_dma = false;
+      else if (!strcmp (name, "-ramdisk"))
+        ramdisk_kb = atoi (value);
 #ifdef VM
       else if (!strcmp (name, "-swap"))
         swap_bdev_name = value;
@@ -257,6 +277,18 @@ parse_options (char **argv)
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-latency"))
+        thread_latency_stats = true;
+      else if (!strcmp (name, "-lockprof"))
+        lock_profiling = true;
+      else if (!strcmp (name, "-profile"))
+        profile_sampling = true;
+      else if (!strcmp (name, "-trace"))
+        {
+          trace_enabled = true;
+          if (value != NULL)
+            trace_page_cnt = atoi (value);
+        }
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
@@ -316,6 +348,7 @@ run_actions (char **argv)
       {"rm", 2, fsutil_rm},
       {"extract", 1, fsutil_extract},
       {"append", 2, fsutil_append},
+      {"diskbench", 2, fsutil_diskbench},
 #endif
       {NULL, 0, NULL},
     };
@@ -362,6 +395,7 @@ usage (void)
           "  ls                 List files in the root directory.\n"
           "  cat FILE           Print FILE to the console.\n"
           "  rm FILE            Delete FILE.\n"
+          "  diskbench MB       Time MB of I/O to the scratch device (erases it).\n"
           "Use these actions indirectly via `pintos' -g and -p options:\n"
           "  extract            Untar from scratch device into file system.\n"
           "  append FILE        Append FILE to tar file on scratch device.\n"
@@ -374,12 +408,18 @@ usage (void)
           "  -f                 Format file system device during startup.\n"
           "  -filesys=BDEV      Use BDEV for file system instead of default.\n"
           "  -scratch=BDEV      Use BDEV for scratch instead of default.\n"
+          "  -nodma             Use PIO instead of DMA for IDE disks.\n"
+          "  -ramdisk=KB        Create a KB kB block device named \"ramdisk\".\n"
 #ifdef VM
           "  -swap=BDEV         Use BDEV for swap instead of default.\n"
 #endif
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -latency           Record wakeup and interrupts-off latency.\n"
+          "  -lockprof          Profile lock contention, report at shutdown.\n"
+          "  -profile           Sample EIP at each timer tick, dump at shutdown.\n"
+          "  -trace[=PAGES]     Trace kernel events, dump to serial at shutdown.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -1,5 +1,6 @@
 #include "threads/interrupt.h"
 #include <debug.h>
+#include <histogram.h>
 #include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -47,6 +48,36 @@ static unsigned int unexpected_cnt[INTR_CNT];
 static bool in_external_intr;   /* Are we processing an external interrupt? */
 static bool yield_on_return;    /* Should we yield on interrupt return? */
 
+/* Interrupts-off regions.
+
+   Each time interrupts go from on to off we note the time and
+   who turned them off: the caller of intr_disable() or
+   intr_set_level(), or the handler, if an interrupt did it.
+   When they go back on, the length of the region in TSC cycles
+   goes into a histogram for that site.  Interrupts can also come
+   back on without our knowledge, by "iret" or by "sti" in
+   idle(), so an interrupt that arrives while they were on
+   discards any region that is still open. */
+struct intr_off_site
+  {
+    uintptr_t caller;           /* Return address or handler, 0 if unused. */
+    const char *name;           /* Interrupt name for handlers, else null. */
+    struct histogram hist;      /* Region lengths. */
+  };
+
+/* Number of sites tracked.  The last slot is shared by all the
+   sites that do not fit in the others. */
+#define OFF_SITE_CNT 64
+
+static struct intr_off_site off_sites[OFF_SITE_CNT];
+static uint64_t off_tsc;        /* When interrupts went off, 0 if unknown. */
+static uintptr_t off_caller;    /* Who turned them off. */
+static const char *off_name;    /* Interrupt name, if a handler did. */
+
+static void intr_off_begin (uintptr_t caller, const char *name);
+static void intr_off_end (void);
+static enum intr_level disable (uintptr_t caller);
+
 /* Programmable Interrupt Controller helpers. */
 static void pic_init (void);
 static void pic_end_of_interrupt (int irq);
@@ -80,7 +111,9 @@ intr_get_level (void)
 enum intr_level
 intr_set_level (enum intr_level level) 
 {
-  return level == INTR_ON ? intr_enable () : intr_disable ();
+  return (level == INTR_ON
+          ? intr_enable ()
+          : disable ((uintptr_t) __builtin_return_address (0)));
 }
 
 /* Enables interrupts and returns the previous interrupt status. */
@@ -90,6 +123,9 @@ intr_enable (void)
   enum intr_level old_level = intr_get_level ();
   ASSERT (!intr_context ());
 
+  if (old_level == INTR_OFF && thread_latency_stats)
+    intr_off_end ();
+
   /* Enable interrupts by setting the interrupt flag.
 
      See [IA32-v2b] "STI" and [IA32-v3a] 5.8.1 "Masking Maskable
@@ -102,6 +138,14 @@ intr_enable (void)
 /* Disables interrupts and returns the previous interrupt status. */
 enum intr_level
 intr_disable (void) 
+{
+  return disable ((uintptr_t) __builtin_return_address (0));
+}
+
+/* Disables interrupts on behalf of CALLER and returns the
+   previous interrupt status. */
+static enum intr_level
+disable (uintptr_t caller) 
 {
   enum intr_level old_level = intr_get_level ();
 
@@ -110,6 +154,9 @@ intr_disable (void)
      Hardware Interrupts". */
   asm volatile ("cli" : : : "memory");
 
+  if (old_level == INTR_ON && thread_latency_stats)
+    intr_off_begin (caller, NULL);
+
   return old_level;
 }
 
@@ -361,8 +408,15 @@ intr_handler (struct intr_frame *frame)
       yield_on_return = false;
     }
 
-  /* Invoke the interrupt's handler. */
+  /* If the interrupted code had interrupts on, then they just
+     went off because of us, not because of any region we might
+     have open. */
   handler = intr_handlers[frame->vec_no];
+  if (thread_latency_stats
+      && (frame->eflags & FLAG_IF) && intr_get_level () == INTR_OFF)
+    intr_off_begin ((uintptr_t) handler, intr_names[frame->vec_no]);
+
+  /* Invoke the interrupt's handler. */
   if (handler != NULL)
     handler (frame);
   else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f)
@@ -386,6 +440,11 @@ intr_handler (struct intr_frame *frame)
       if (yield_on_return) 
         thread_yield (); 
     }
+
+  /* "iret" is about to turn interrupts back on. */
+  if (thread_latency_stats
+      && (frame->eflags & FLAG_IF) && intr_get_level () == INTR_OFF)
+    intr_off_end ();
 }
 
 /* Handles an unexpected interrupt with interrupt frame F.  An
@@ -436,3 +495,92 @@ intr_name (uint8_t vec)
 {
   return intr_names[vec];
 }
+
+/* Notes that interrupts just went off on behalf of CALLER,
+   which is an interrupt handler named NAME if NAME is
+   nonnull. */
+static void
+intr_off_begin (uintptr_t caller, const char *name) 
+{
+  off_tsc = rdtsc ();
+  off_caller = caller;
+  off_name = name;
+}
+
+/* Notes that interrupts are about to go back on, and adds the
+   length of the region just ended to its site's histogram. */
+static void
+intr_off_end (void) 
+{
+  uint64_t cycles;
+  unsigned i, hash;
+
+  if (off_tsc == 0)
+    return;
+  cycles = rdtsc () - off_tsc;
+  off_tsc = 0;
+
+  hash = (off_caller >> 2) * 2654435761u;
+  for (i = 0; i < OFF_SITE_CNT - 1; i++)
+    {
+      struct intr_off_site *s = &off_sites[(hash + i) % (OFF_SITE_CNT - 1)];
+      if (s->caller == off_caller)
+        {
+          histogram_add (&s->hist, cycles);
+          return;
+        }
+      else if (s->caller == 0)
+        {
+          s->caller = off_caller;
+          s->name = off_name;
+          histogram_add (&s->hist, cycles);
+          return;
+        }
+    }
+  histogram_add (&off_sites[OFF_SITE_CNT - 1].hist, cycles);
+}
+
+/* Prints the interrupts-off histograms, longest region first.
+   Sites that are not interrupt handlers are shown as the return
+   address of the call that turned interrupts off, which
+   "backtrace" will translate into a function name. */
+void
+intr_print_stats (void) 
+{
+  struct intr_off_site *sorted[OFF_SITE_CNT];
+  enum intr_level old_level;
+  size_t cnt = 0;
+  size_t i;
+
+  /* Take a snapshot of the order, since printing turns
+     interrupts off and on itself. */
+  old_level = intr_disable ();
+  for (i = 0; i < OFF_SITE_CNT; i++)
+    {
+      struct intr_off_site *s = &off_sites[i];
+      size_t j;
+
+      if (s->hist.cnt == 0)
+        continue;
+      for (j = cnt++; j > 0 && sorted[j - 1]->hist.max < s->hist.max; j--)
+        sorted[j] = sorted[j - 1];
+      sorted[j] = s;
+    }
+  intr_set_level (old_level);
+
+  for (i = 0; i < cnt; i++)
+    {
+      struct intr_off_site *s = sorted[i];
+      char prefix[64];
+
+      if (s == &off_sites[OFF_SITE_CNT - 1])
+        snprintf (prefix, sizeof prefix, "Intr-off: (other sites)");
+      else if (s->name != NULL)
+        snprintf (prefix, sizeof prefix, "Intr-off: %#010"PRIxPTR" (%s)",
+                  s->caller, s->name);
+      else
+        snprintf (prefix, sizeof prefix, "Intr-off: %#010"PRIxPTR,
+                  s->caller);
+      histogram_print (&s->hist, prefix);
+    }
+}
@@ -112,4 +112,15 @@ outsl (uint16_t port, const void *addr, size_t cnt)
   asm volatile ("rep outsl" : "+S" (addr), "+c" (cnt) : "d" (port));
 }
 
+/* Returns the processor's time-stamp counter, which counts
+   clock cycles since reset. */
+static inline uint64_t
+rdtsc (void)
+{
+  /* See [IA32-v2b] "RDTSC". */
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
 #endif /* threads/io.h */
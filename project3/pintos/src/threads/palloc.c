@@ -7,6 +7,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -23,7 +24,26 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Each pool also keeps a small stack of pages that the idle
+   thread has zeroed ahead of time (see palloc_prezero()), so that
+   single-page PAL_ZERO allocations usually skip the memset.
+   These pages are marked used in the bitmap, so that nothing
+   else hands them out, but they count as free: a single-page
+   allocation that finds the bitmap full takes one of them, and
+   a multi-page allocation that finds no run long enough puts
+   them all back in the bitmap and tries again.  The same goes
+   for the page the idle thread is zeroing at the moment.  It
+   zeroes it a piece at a time with interrupts off, checking
+   before each piece that no allocation has taken the page, so
+   it stops as soon as one has. */
+
+/* Most pre-zeroed pages kept per pool. */
+#define ZEROED_MAX 64
+
+/* Bytes the idle thread zeroes at a time with interrupts off. */
+#define ZERO_CHUNK 512
 
 /* A memory pool. */
 struct pool
@@ -31,6 +51,17 @@ struct pool
     struct lock lock;                   /* Mutual exclusion. */
     struct bitmap *used_map;            /* Bitmap of free pages. */
     uint8_t *base;                      /* Base of pool. */
+
+    /* Pre-zeroed pages.  Protected by disabling interrupts, so
+       that the idle thread can use them without blocking. */
+    void *zeroed[ZEROED_MAX];           /* Stack of zeroed pages. */
+    size_t zeroed_cnt;                  /* Number of pages in stack. */
+    void *zeroing;                      /* Page being zeroed, or null. */
+
+    /* Statistics.  Protected by lock. */
+    unsigned long long zero_hits;       /* PAL_ZERO served pre-zeroed. */
+    unsigned long long zero_misses;     /* PAL_ZERO zeroed on demand. */
+    unsigned long long prezeroed;       /* Pages taken to zero when idle. */
   };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -38,6 +69,9 @@ static struct pool kernel_pool, user_pool;
 
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
+static void *take_zeroed (struct pool *);
+static void *take_zeroing (struct pool *);
+static bool release_zeroed (struct pool *);
 static bool page_from_pool (const struct pool *, void *page);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
@@ -71,24 +105,43 @@ void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 {
   struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
-  void *pages;
+  void *pages = NULL;
+  bool zeroed = false;
   size_t page_idx;
 
   if (page_cnt == 0)
     return NULL;
 
   lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
+  if (page_cnt == 1 && (flags & PAL_ZERO))
+    zeroed = (pages = take_zeroed (pool)) != NULL;
+  if (pages == NULL)
+    {
+      page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+      if (page_idx == BITMAP_ERROR && page_cnt > 1 && release_zeroed (pool))
+        page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
 
-  if (page_idx != BITMAP_ERROR)
-    pages = pool->base + PGSIZE * page_idx;
-  else
-    pages = NULL;
+      if (page_idx != BITMAP_ERROR)
+        pages = pool->base + PGSIZE * page_idx;
+      else if (page_cnt == 1)
+        {
+          zeroed = (pages = take_zeroed (pool)) != NULL;
+          if (pages == NULL)
+            pages = take_zeroing (pool);
+        }
+    }
+  if (pages != NULL && page_cnt == 1 && (flags & PAL_ZERO))
+    {
+      if (zeroed)
+        pool->zero_hits++;
+      else
+        pool->zero_misses++;
+    }
+  lock_release (&pool->lock);
 
   if (pages != NULL) 
     {
-      if (flags & PAL_ZERO)
+      if ((flags & PAL_ZERO) && !zeroed)
         memset (pages, 0, PGSIZE * page_cnt);
     }
   else 
@@ -148,6 +201,153 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
+/* Returns the number of pages in the user pool. */
+size_t
+palloc_user_page_cnt (void) 
+{
+  return bitmap_size (user_pool.used_map);
+}
+
+/* Pops a pre-zeroed page off POOL's stack and returns it, or
+   returns a null pointer if the stack is empty.  POOL's lock
+   must be held. */
+static void *
+take_zeroed (struct pool *pool)
+{
+  enum intr_level old_level = intr_disable ();
+  void *page = pool->zeroed_cnt > 0 ? pool->zeroed[--pool->zeroed_cnt] : NULL;
+  intr_set_level (old_level);
+
+  return page;
+}
+
+/* Takes the page that the idle thread is zeroing in POOL away
+   from it and returns it, not fully zeroed, or returns a null
+   pointer if there is no such page.  POOL's lock must be
+   held. */
+static void *
+take_zeroing (struct pool *pool)
+{
+  enum intr_level old_level = intr_disable ();
+  void *page = pool->zeroing;
+  pool->zeroing = NULL;
+  intr_set_level (old_level);
+
+  return page;
+}
+
+/* Marks all of POOL's pre-zeroed pages, and the page being
+   zeroed, free in its bitmap and empties its stack.  Returns
+   true if there were any.  POOL's lock must be held. */
+static bool
+release_zeroed (struct pool *pool)
+{
+  enum intr_level old_level = intr_disable ();
+  bool released = pool->zeroed_cnt > 0 || pool->zeroing != NULL;
+
+  while (pool->zeroed_cnt > 0)
+    {
+      void *page = pool->zeroed[--pool->zeroed_cnt];
+      bitmap_reset (pool->used_map, pg_no (page) - pg_no (pool->base));
+    }
+  if (pool->zeroing != NULL)
+    {
+      bitmap_reset (pool->used_map,
+                    pg_no (pool->zeroing) - pg_no (pool->base));
+      pool->zeroing = NULL;
+    }
+  intr_set_level (old_level);
+
+  return released;
+}
+
+/* Zeroes one free page, from the user pool by preference, and
+   puts it on its pool's stack of pre-zeroed pages.  Returns true
+   if it did, false if every stack is full, no page is free, or a
+   pool is busy.  Never blocks, so that the idle thread may call
+   it; it must be called with interrupts on, so that zeroing the
+   page can be preempted between pieces. */
+bool
+palloc_prezero (void)
+{
+  struct pool *pools[2] = { &user_pool, &kernel_pool };
+  int i;
+
+  ASSERT (intr_get_level () == INTR_ON);
+
+  for (i = 0; i < 2; i++)
+    {
+      struct pool *pool = pools[i];
+      enum intr_level old_level;
+      size_t page_idx;
+      uint8_t *page;
+      size_t ofs;
+
+      if (pool->zeroed_cnt >= ZEROED_MAX || !lock_try_acquire (&pool->lock))
+        continue;
+      page_idx = bitmap_scan_and_flip (pool->used_map, 0, 1, false);
+      if (page_idx != BITMAP_ERROR)
+        {
+          page = pool->base + PGSIZE * page_idx;
+          old_level = intr_disable ();
+          pool->zeroing = page;
+          intr_set_level (old_level);
+          pool->prezeroed++;
+        }
+      lock_release (&pool->lock);
+      if (page_idx == BITMAP_ERROR)
+        continue;
+
+      /* An allocation may take the page between pieces, but not
+         during one. */
+      for (ofs = 0; ofs < PGSIZE; ofs += ZERO_CHUNK)
+        {
+          old_level = intr_disable ();
+          if (pool->zeroing != page)
+            {
+              intr_set_level (old_level);
+              return true;
+            }
+          memset (page + ofs, 0, ZERO_CHUNK);
+          intr_set_level (old_level);
+        }
+
+      /* Only the idle thread pushes, so there is still room. */
+      old_level = intr_disable ();
+      if (pool->zeroing == page)
+        {
+          ASSERT (pool->zeroed_cnt < ZEROED_MAX);
+          pool->zeroed[pool->zeroed_cnt++] = page;
+          pool->zeroing = NULL;
+        }
+      intr_set_level (old_level);
+      return true;
+    }
+  return false;
+}
+
+/* Prints how often single-page PAL_ZERO allocations found a
+   pre-zeroed page. */
+void
+palloc_print_stats (void)
+{
+  struct pool *pools[2] = { &kernel_pool, &user_pool };
+  static const char *names[2] = { "kernel", "user" };
+  int i;
+
+  for (i = 0; i < 2; i++)
+    {
+      struct pool *pool = pools[i];
+      unsigned long long total = pool->zero_hits + pool->zero_misses;
+
+      printf ("Palloc: %s pool: %llu of %llu zeroed pages pre-zeroed "
+              "(%llu%%), %llu zeroed while idle, %zu on hand\n",
+              names[i], pool->zero_hits, total,
+              total > 0 ? pool->zero_hits * 100 / total : 0,
+              pool->prezeroed, pool->zeroed_cnt);
+    }
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
@@ -165,8 +365,12 @@ init_pool (struct pool *p, void *base, size_t page_cnt, const char *name)
 
   /* Initialize the pool. */
   lock_init (&p->lock);
+  lock_profile (&p->lock, name);
   p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
   p->base = base + bm_pages * PGSIZE;
+  p->zeroed_cnt = 0;
+  p->zeroing = NULL;
+  p->zero_hits = p->zero_misses = p->prezeroed = 0;
 }
 
 /* Returns true if PAGE was allocated from POOL,
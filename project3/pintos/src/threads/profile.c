@@ -0,0 +1,116 @@
+#include "threads/profile.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Sampling profiler.
+
+   When enabled, the timer interrupt handler passes each
+   interrupted frame to profile_sample(), which counts how many
+   times each (instruction, thread) pair was interrupted.  The
+   counts live in a fixed-size open-addressed hash table
+   allocated once at boot, so sampling never allocates memory
+   and never takes a lock; it runs with interrupts off.
+
+   At shutdown the table is printed as one line per entry:
+
+        Profile: ADDRESS COUNT TID NAME
+
+   "backtrace --profile" reads those lines and turns them into
+   a flat profile by function. */
+
+/* One histogram bucket. */
+struct sample
+  {
+    uintptr_t eip;              /* Interrupted instruction. */
+    tid_t tid;                  /* Thread that was running. */
+    unsigned count;             /* Number of hits, 0 if unused. */
+    char name[16];              /* Thread's name at first hit. */
+  };
+
+/* Number of buckets.  Must be a power of 2. */
+#define SAMPLE_CNT 1024
+
+/* Number of buckets to probe before giving up on a sample. */
+#define MAX_PROBES 16
+
+/* See profile.h. */
+bool profile_sampling;
+
+static struct sample *samples;          /* SAMPLE_CNT buckets. */
+static long long sample_cnt;            /* Samples recorded. */
+static long long dropped_cnt;           /* Samples lost to a full table. */
+
+/* Allocates the histogram, if sampling was requested on the
+   kernel command line.  Must be called after palloc_init() and
+   before interrupts are enabled. */
+void
+profile_init (void)
+{
+  size_t page_cnt = DIV_ROUND_UP (SAMPLE_CNT * sizeof *samples, PGSIZE);
+
+  if (!profile_sampling)
+    return;
+  samples = palloc_get_multiple (PAL_ASSERT | PAL_ZERO, page_cnt);
+}
+
+/* Records one sample for interrupted frame F.
+   Called by the timer interrupt handler at each tick. */
+void
+profile_sample (const struct intr_frame *f)
+{
+  struct thread *t = thread_current ();
+  uintptr_t eip = (uintptr_t) f->eip;
+  unsigned hash;
+  int i;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (samples == NULL)
+    return;
+
+  hash = (eip >> 2) ^ ((unsigned) t->tid * 2654435761u);
+  for (i = 0; i < MAX_PROBES; i++)
+    {
+      struct sample *s = &samples[(hash + i) & (SAMPLE_CNT - 1)];
+      if (s->count == 0)
+        {
+          s->eip = eip;
+          s->tid = t->tid;
+          strlcpy (s->name, t->name, sizeof s->name);
+        }
+      else if (s->eip != eip || s->tid != t->tid)
+        continue;
+
+      s->count++;
+      sample_cnt++;
+      return;
+    }
+  dropped_cnt++;
+}
+
+/* Prints the histogram in the format described at the top of
+   this file.  Prints nothing if sampling is disabled. */
+void
+profile_print_stats (void)
+{
+  size_t i;
+
+  if (samples == NULL)
+    return;
+
+  printf ("Profile: %lld samples, %lld dropped\n", sample_cnt, dropped_cnt);
+  for (i = 0; i < SAMPLE_CNT; i++)
+    {
+      struct sample *s = &samples[i];
+      if (s->count > 0)
+        printf ("Profile: %#010"PRIxPTR" %u %d %s\n",
+                s->eip, s->count, s->tid, s->name);
+    }
+}
@@ -0,0 +1,19 @@
+#ifndef THREADS_PROFILE_H
+#define THREADS_PROFILE_H
+
+#include <stdbool.h>
+
+struct intr_frame;
+
+/* If false (default), the timer interrupt does not sample.
+   If true, each timer tick records the interrupted instruction
+   and thread in an in-memory histogram that is dumped at
+   shutdown.  Controlled by kernel command-line option
+   "-profile". */
+extern bool profile_sampling;
+
+void profile_init (void);
+void profile_sample (const struct intr_frame *);
+void profile_print_stats (void);
+
+#endif /* threads/profile.h */
@@ -30,8 +30,38 @@
 #include <stdio.h>
 #include <string.h>
 #include "threads/interrupt.h"
+#include "threads/io.h"
 #include "threads/thread.h"
 
+/* Contention statistics for one profiled lock or semaphore. */
+struct synch_profile
+  {
+    char name[24];              /* Name given to lock_profile(). */
+    const char *file;           /* Source file of the call... */
+    int line;                   /* ...and its line number. */
+    bool is_lock;               /* Lock or bare semaphore? */
+
+    long long acquire_cnt;      /* Successful downs or acquires. */
+    long long contended_cnt;    /* Acquisitions that had to wait. */
+    uint64_t wait_cycles;       /* Total TSC cycles spent waiting. */
+    uint64_t max_wait_cycles;   /* Longest single wait. */
+    uint64_t hold_cycles;       /* Total cycles held (locks only). */
+    uint64_t acquired_at;       /* TSC when the current holder got it. */
+  };
+
+/* See synch.h. */
+bool lock_profiling;
+
+/* Profiled locks and semaphores.  Profiling is meant for
+   long-lived, statically known locks, so a small fixed table is
+   enough and lets us tag locks before malloc() works. */
+#define PROFILE_CNT 32
+static struct synch_profile profiles[PROFILE_CNT];
+static size_t profile_cnt;
+
+static void profile_acquired (struct synch_profile *, bool waited,
+                              uint64_t wait_start);
+
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
    manipulating it:
@@ -48,6 +78,7 @@ sema_init (struct semaphore *sema, unsigned value)
 
   sema->value = value;
   list_init (&sema->waiters);
+  sema->profile = NULL;
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -61,17 +92,26 @@ void
 sema_down (struct semaphore *sema) 
 {
   enum intr_level old_level;
+  bool waited = false;
+  uint64_t wait_start = 0;
 
   ASSERT (sema != NULL);
   ASSERT (!intr_context ());
 
   old_level = intr_disable ();
+  if (sema->value == 0 && sema->profile != NULL)
+    {
+      waited = true;
+      wait_start = rdtsc ();
+    }
   while (sema->value == 0) 
     {
       list_push_back (&sema->waiters, &thread_current ()->elem);
       thread_block ();
     }
   sema->value--;
+  if (sema->profile != NULL)
+    profile_acquired (sema->profile, waited, wait_start);
   intr_set_level (old_level);
 }
 
@@ -93,6 +133,8 @@ sema_try_down (struct semaphore *sema)
     {
       sema->value--;
       success = true; 
+      if (sema->profile != NULL)
+        profile_acquired (sema->profile, false, 0);
     }
   else
     success = false;
@@ -198,6 +240,8 @@ lock_acquire (struct lock *lock)
 
   sema_down (&lock->semaphore);
   lock->holder = thread_current ();
+  if (lock->semaphore.profile != NULL)
+    lock->semaphore.profile->acquired_at = rdtsc ();
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -216,7 +260,11 @@ lock_try_acquire (struct lock *lock)
 
   success = sema_try_down (&lock->semaphore);
   if (success)
-    lock->holder = thread_current ();
+    {
+      lock->holder = thread_current ();
+      if (lock->semaphore.profile != NULL)
+        lock->semaphore.profile->acquired_at = rdtsc ();
+    }
   return success;
 }
 
@@ -231,6 +279,11 @@ lock_release (struct lock *lock)
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
 
+  if (lock->semaphore.profile != NULL)
+    {
+      struct synch_profile *p = lock->semaphore.profile;
+      p->hold_cycles += rdtsc () - p->acquired_at;
+    }
   lock->holder = NULL;
   sema_up (&lock->semaphore);
 }
@@ -246,6 +299,122 @@ lock_held_by_current_thread (const struct lock *lock)
   return lock->holder == thread_current ();
 }
 
+/* Tags SEMA with NAME and the given source location and starts
+   collecting contention statistics for it, if lock profiling is
+   enabled.  Use the sema_profile() macro instead of calling this
+   directly.  SEMA must never be freed, since the statistics are
+   reported at shutdown. */
+void
+sema_profile_at (struct semaphore *sema, const char *name,
+                 const char *file, int line)
+{
+  struct synch_profile *p;
+  enum intr_level old_level;
+
+  ASSERT (sema != NULL);
+  ASSERT (name != NULL);
+
+  if (!lock_profiling)
+    return;
+
+  old_level = intr_disable ();
+  if (profile_cnt >= PROFILE_CNT)
+    {
+      intr_set_level (old_level);
+      printf ("lock profile full, not profiling \"%s\"\n", name);
+      return;
+    }
+  p = &profiles[profile_cnt++];
+  memset (p, 0, sizeof *p);
+  strlcpy (p->name, name, sizeof p->name);
+  p->file = file;
+  p->line = line;
+  sema->profile = p;
+  intr_set_level (old_level);
+}
+
+/* Tags LOCK with NAME and the given source location and starts
+   collecting contention and hold-time statistics for it, if lock
+   profiling is enabled.  Use the lock_profile() macro instead of
+   calling this directly. */
+void
+lock_profile_at (struct lock *lock, const char *name,
+                 const char *file, int line)
+{
+  ASSERT (lock != NULL);
+
+  sema_profile_at (&lock->semaphore, name, file, line);
+  if (lock->semaphore.profile != NULL)
+    lock->semaphore.profile->is_lock = true;
+}
+
+/* Records an acquisition for profile P.  If WAITED, the
+   acquirer had to wait, starting at TSC value WAIT_START.  Must
+   be called with interrupts off. */
+static void
+profile_acquired (struct synch_profile *p, bool waited, uint64_t wait_start)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  p->acquire_cnt++;
+  if (waited)
+    {
+      uint64_t wait = rdtsc () - wait_start;
+      p->contended_cnt++;
+      p->wait_cycles += wait;
+      if (wait > p->max_wait_cycles)
+        p->max_wait_cycles = wait;
+    }
+}
+
+/* Prints the statistics collected for profiled locks and
+   semaphores, sorted by decreasing total wait time.  Prints
+   nothing if lock profiling is disabled.
+
+   May be called from an interrupt handler, so that the profile
+   can be dumped with a debug key while the system is loaded. */
+void
+lock_print_stats (void)
+{
+  struct synch_profile *sorted[PROFILE_CNT];
+  size_t i, j;
+
+  if (!lock_profiling)
+    return;
+
+  /* Insertion sort by total wait. */
+  for (i = 0; i < profile_cnt; i++)
+    {
+      struct synch_profile *p = &profiles[i];
+      for (j = i; j > 0 && sorted[j - 1]->wait_cycles < p->wait_cycles; j--)
+        sorted[j] = sorted[j - 1];
+      sorted[j] = p;
+    }
+
+  printf ("Lock profile: %zu locks, times in kcycles\n", profile_cnt);
+  printf ("  %-16s %10s %10s %8s %6s %8s  %s\n",
+          "name", "acquires", "contended", "wait", "max", "hold", "site");
+  for (i = 0; i < profile_cnt; i++)
+    {
+      struct synch_profile *p = sorted[i];
+      const char *file = p->file;
+      char hold[24];
+
+      /* Drop the "../../" that the build directory adds. */
+      while (file[0] == '.' && file[1] == '.' && file[2] == '/')
+        file += 3;
+      if (p->is_lock)
+        snprintf (hold, sizeof hold, "%llu", p->hold_cycles / 1000);
+      else
+        strlcpy (hold, "-", sizeof hold);
+
+      printf ("  %-16s %10lld %10lld %8llu %6llu %8s  %s:%d\n",
+              p->name, p->acquire_cnt, p->contended_cnt,
+              p->wait_cycles / 1000, p->max_wait_cycles / 1000, hold,
+              file, p->line);
+    }
+}
+
 /* One semaphore in a list. */
 struct semaphore_elem 
   {
@@ -336,3 +505,179 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   while (!list_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
+
+/* Initializes readers-writer lock RW.  A readers-writer lock
+   may be held by any number of readers or by a single writer,
+   but never by readers and a writer at the same time.
+
+   The lock is writer-preferring: once a writer is waiting, new
+   readers block until it has acquired and released the lock.
+   As with struct lock, the lock is not recursive, so a thread
+   holding RW for reading must not try to acquire it again. */
+void
+rwlock_init (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_init (&rw->lock);
+  cond_init (&rw->readers_ok);
+  cond_init (&rw->writers_ok);
+  rw->active_readers = 0;
+  rw->waiting_writers = 0;
+  rw->writer = NULL;
+}
+
+/* Acquires RW for reading, sleeping until no writer holds or is
+   waiting for it.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+
+  lock_acquire (&rw->lock);
+  while (rw->writer != NULL || rw->waiting_writers > 0)
+    cond_wait (&rw->readers_ok, &rw->lock);
+  rw->active_readers++;
+  lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread must hold for
+   reading.  Wakes up a waiting writer if this was the last
+   reader. */
+void
+rwlock_release_read (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_acquire (&rw->lock);
+  ASSERT (rw->active_readers > 0);
+  if (--rw->active_readers == 0 && rw->waiting_writers > 0)
+    cond_signal (&rw->writers_ok, &rw->lock);
+  lock_release (&rw->lock);
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds
+   it.  RW must not already be held by the current thread.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (!rwlock_held_for_write (rw));
+
+  lock_acquire (&rw->lock);
+  rw->waiting_writers++;
+  while (rw->writer != NULL || rw->active_readers > 0)
+    cond_wait (&rw->writers_ok, &rw->lock);
+  rw->waiting_writers--;
+  rw->writer = thread_current ();
+  lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread must hold for writing.
+   Hands the lock to the next waiting writer, if any, and
+   otherwise wakes up all waiting readers. */
+void
+rwlock_release_write (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+  ASSERT (rwlock_held_for_write (rw));
+
+  lock_acquire (&rw->lock);
+  rw->writer = NULL;
+  if (rw->waiting_writers > 0)
+    cond_signal (&rw->writers_ok, &rw->lock);
+  else
+    cond_broadcast (&rw->readers_ok, &rw->lock);
+  lock_release (&rw->lock);
+}
+
+/* Returns true if the current thread holds RW for writing,
+   false otherwise. */
+bool
+rwlock_held_for_write (const struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  return rw->writer == thread_current ();
+}
+
+/* Initializes sequence lock SEQ. */
+void
+seqlock_init (struct seqlock *seq)
+{
+  ASSERT (seq != NULL);
+
+  seq->sequence = 0;
+}
+
+/* Begins a read of the data protected by SEQ and returns a
+   value to pass to seqlock_read_retry() once the data has been
+   copied out.  Typical usage is:
+
+        do
+          {
+            start = seqlock_read_begin (&seq);
+            copy = data;
+          }
+        while (seqlock_read_retry (&seq, start));
+
+   This function never sleeps, so it may be called within an
+   interrupt handler. */
+unsigned
+seqlock_read_begin (const struct seqlock *seq)
+{
+  unsigned start;
+
+  ASSERT (seq != NULL);
+
+  /* Wait out a write in progress.  On a single CPU this can only
+     happen if the writer was preempted, so the wait ends at the
+     writer's next time slice. */
+  while ((start = seq->sequence) & 1)
+    barrier ();
+  barrier ();
+  return start;
+}
+
+/* Returns true if a write to the data protected by SEQ
+   overlapped the read that began when seqlock_read_begin()
+   returned START, in which case the read must be retried. */
+bool
+seqlock_read_retry (const struct seqlock *seq, unsigned start)
+{
+  ASSERT (seq != NULL);
+
+  barrier ();
+  return seq->sequence != start;
+}
+
+/* Begins a write to the data protected by SEQ.  Writers must be
+   serialized with respect to each other by the caller. */
+void
+seqlock_write_begin (struct seqlock *seq)
+{
+  ASSERT (seq != NULL);
+  ASSERT ((seq->sequence & 1) == 0);
+
+  seq->sequence++;
+  barrier ();
+}
+
+/* Ends a write to the data protected by SEQ. */
+void
+seqlock_write_end (struct seqlock *seq)
+{
+  ASSERT (seq != NULL);
+  ASSERT ((seq->sequence & 1) != 0);
+
+  barrier ();
+  seq->sequence++;
+}
@@ -9,6 +9,7 @@ struct semaphore
   {
     unsigned value;             /* Current value. */
     struct list waiters;        /* List of waiting threads. */
+    struct synch_profile *profile; /* Contention statistics, if any. */
   };
 
 void sema_init (struct semaphore *, unsigned value);
@@ -30,6 +31,25 @@ bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
 
+/* Lock profiling.
+   If false (default), lock_profile() and sema_profile() do
+   nothing.  If true, each lock or semaphore passed to them is
+   tagged with NAME and the source location of the call, and
+   collects acquisition, contention, wait and hold statistics.
+   Controlled by kernel command-line option "-lockprof". */
+extern bool lock_profiling;
+
+#define lock_profile(LOCK, NAME) \
+        lock_profile_at (LOCK, NAME, __FILE__, __LINE__)
+#define sema_profile(SEMA, NAME) \
+        sema_profile_at (SEMA, NAME, __FILE__, __LINE__)
+
+void lock_profile_at (struct lock *, const char *name,
+                      const char *file, int line);
+void sema_profile_at (struct semaphore *, const char *name,
+                      const char *file, int line);
+void lock_print_stats (void);
+
 /* Condition variable. */
 struct condition 
   {
@@ -41,6 +61,44 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Readers-writer lock.
+   Any number of readers may hold the lock at once, or a single
+   writer.  Waiting writers take precedence over new readers, so
+   a steady stream of readers cannot starve a writer. */
+struct rwlock
+  {
+    struct lock lock;           /* Protects the members below. */
+    struct condition readers_ok; /* Signaled when readers may proceed. */
+    struct condition writers_ok; /* Signaled when a writer may proceed. */
+    int active_readers;         /* Number of readers holding the lock. */
+    int waiting_writers;        /* Number of writers waiting. */
+    struct thread *writer;      /* Writer holding the lock, if any. */
+  };
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_held_for_write (const struct rwlock *);
+
+/* Sequence lock.
+   Protects a small value that is written rarely, by a single
+   writer at a time, and read often.  Readers never block or
+   disable interrupts: they retry if a write overlapped their
+   read.  Writers must be serialized by the caller, e.g. by
+   running only in an interrupt handler. */
+struct seqlock
+  {
+    unsigned sequence;          /* Odd while a write is in progress. */
+  };
+
+void seqlock_init (struct seqlock *);
+unsigned seqlock_read_begin (const struct seqlock *);
+bool seqlock_read_retry (const struct seqlock *, unsigned start);
+void seqlock_write_begin (struct seqlock *);
+void seqlock_write_end (struct seqlock *);
+
 /* Optimization barrier.
 
    The compiler will not reorder operations across an
@@ -1,15 +1,18 @@
 #include "threads/thread.h"
 #include <debug.h>
 #include <stddef.h>
+#include <histogram.h>
 #include <random.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
+#include "threads/io.h"
 #include "threads/palloc.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
 #include "threads/malloc.h"
 #include "vm/page.h"
@@ -29,17 +32,32 @@
 static struct list ready_list;
 
 /* List of all processes.  Processes are added to this list
-   when they are first scheduled and removed when they exit. */
+   when they are first scheduled and removed when they exit.
+   The list is only modified with interrupts off, so it may be
+   read with interrupts off. */
 static struct list all_list;
 
+/* Threads in all_list, hashed by tid into TID_BUCKETS chains so
+   that get_thread_by_tid() need not walk every thread.  Guarded
+   exactly like all_list. */
+#define TID_BUCKETS 64
+static struct list tid_table[TID_BUCKETS];
+
 /* Idle thread. */
 static struct thread *idle_thread;
 
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
 
-/* Lock used by allocate_tid(). */
-static struct lock tid_lock;
+/* Pages of threads that have died, kept for reuse by
+   thread_create() so that creating a thread usually needs
+   neither the page allocator nor its debug poisoning on free.
+   Only `struct thread' itself is reinitialized; the rest of the
+   page is the new thread's stack, whose old contents do not
+   matter.  Accessed only with interrupts off. */
+#define THREAD_CACHE_MAX 16
+static struct thread *thread_cache[THREAD_CACHE_MAX];
+static size_t thread_cache_cnt;
 
 /* Stack frame for kernel_thread(). */
 struct kernel_thread_frame 
@@ -53,6 +71,13 @@ struct kernel_thread_frame
 static long long idle_ticks;    /* # of timer ticks spent idle. */
 static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
 static long long user_ticks;    /* # of timer ticks in user programs. */
+static long long create_cnt;    /* # of threads created. */
+static long long cache_hits;    /* # of those given a cached page. */
+
+/* Wakeup-to-run latency, in TSC cycles from thread_unblock() to
+   thread_schedule_tail(), indexed by the priority the thread
+   runs at. */
+static struct histogram wakeup_latency[PRI_MAX + 1];
 
 /* Scheduling. */
 #define TIME_SLICE 4            /* # of timer ticks to give each thread. */
@@ -63,6 +88,11 @@ static unsigned thread_ticks;   /* # of timer ticks since last yield. */
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* If false (default), record nothing.  If true, record the
+   wakeup latency and interrupts-off histograms.  Controlled by
+   kernel command-line option "-latency". */
+bool thread_latency_stats;
+
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
@@ -74,6 +104,8 @@ static void *alloc_frame (struct thread *, size_t size);
 static void schedule (void);
 void thread_schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
+static struct thread *alloc_thread_page (void);
+static void add_thread (struct thread *);
 struct thread *get_thread_by_tid(tid_t tid);
 struct child_process *create_child_process(tid_t tid);
 
@@ -93,19 +125,24 @@ struct child_process *create_child_process(tid_t tid);
 void
 thread_init (void) 
 {
+  int i;
+
   ASSERT (intr_get_level () == INTR_OFF);
 
-  lock_init (&tid_lock);
   list_init (&ready_list);
   list_init (&all_list);
+  for (i = 0; i < TID_BUCKETS; i++)
+    list_init (&tid_table[i]);
   list_init (&frame_table);
   lock_init (&frame_lock);
+  lock_profile (&frame_lock, "frame_lock");
   
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
   init_thread (initial_thread, "main", PRI_DEFAULT);
-  initial_thread->status = THREAD_RUNNING;
   initial_thread->tid = allocate_tid ();
+  add_thread (initial_thread);
+  initial_thread->status = THREAD_RUNNING;
   initial_thread->parent = NULL;
 }
 
@@ -148,12 +185,39 @@ thread_tick (void)
     intr_yield_on_return ();
 }
 
-/* Prints thread statistics. */
+/* Returns the number of timer ticks spent in the idle thread
+   since boot. */
+long long
+thread_idle_ticks (void) 
+{
+  enum intr_level old_level = intr_disable ();
+  long long ticks = idle_ticks;
+  intr_set_level (old_level);
+  return ticks;
+}
+
+/* Prints thread statistics, including the wakeup latency and
+   interrupts-off histograms if they were recorded. */
 void
 thread_print_stats (void) 
 {
+  int pri;
+
   printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
           idle_ticks, kernel_ticks, user_ticks);
+  printf ("Thread: %lld created, %lld from page cache\n",
+          create_cnt, cache_hits);
+  if (!thread_latency_stats)
+    return;
+
+  for (pri = PRI_MAX; pri >= PRI_MIN; pri--)
+    if (wakeup_latency[pri].cnt > 0)
+      {
+        char prefix[32];
+        snprintf (prefix, sizeof prefix, "Wakeup: priority %d", pri);
+        histogram_print (&wakeup_latency[pri], prefix);
+      }
+  intr_print_stats ();
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -179,23 +243,28 @@ thread_create (const char *name, int priority,
   struct kernel_thread_frame *kf;
   struct switch_entry_frame *ef;
   struct switch_threads_frame *sf;
+  enum intr_level old_level;
   tid_t tid;
 
   ASSERT (function != NULL);
 
   /* Allocate thread. */
-  t = palloc_get_page (PAL_ZERO);
+  t = alloc_thread_page ();
   if (t == NULL)
     return TID_ERROR;
 
   /* Initialize thread. */
   init_thread (t, name, priority);
   tid = t->tid = allocate_tid ();
+  old_level = intr_disable ();
+  add_thread (t);
+  intr_set_level (old_level);
   t->parent = thread_current();
   
   struct child_process *cp = create_child_process(t->tid);
   t->self_child = cp;
-  list_push_back(&thread_current()->children, &cp->elem);
+  list_push_back(&thread_current()->children[tid % CHILD_BUCKETS],
+                 &cp->elem);
 
   /* Stack frame for kernel_thread(). */
   kf = alloc_frame (t, sizeof *kf);
@@ -244,6 +313,7 @@ thread_block (void)
   ASSERT (!intr_context ());
   ASSERT (intr_get_level () == INTR_OFF);
 
+  TRACE (TRACE_BLOCK, 0, 0, 0);
   thread_current ()->status = THREAD_BLOCKED;
   schedule ();
 }
@@ -265,6 +335,9 @@ thread_unblock (struct thread *t)
 
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
+  TRACE (TRACE_UNBLOCK, t->tid, 0, 0);
+  if (thread_latency_stats)
+    t->wakeup_tsc = rdtsc ();
   list_push_back (&ready_list, &t->elem);
   t->status = THREAD_READY;
   intr_set_level (old_level);
@@ -319,6 +392,7 @@ thread_exit (void)
      when it calls thread_schedule_tail(). */
   intr_disable ();
   list_remove (&thread_current()->allelem);
+  list_remove (&thread_current()->tidelem);
   thread_current ()->status = THREAD_DYING;
   schedule ();
   NOT_REACHED ();
@@ -426,6 +500,15 @@ idle (void *idle_started_ UNUSED)
       intr_disable ();
       thread_block ();
 
+      /* Nothing else is ready, so zero a free page for a later
+         PAL_ZERO allocation.  An interrupt that readies another
+         thread preempts us as usual.  Then go around again,
+         until there is no more to do. */
+      intr_enable ();
+      if (palloc_prezero ())
+        continue;
+      intr_disable ();
+
       /* Re-enable interrupts and wait for the next one.
 
          The `sti' instruction disables interrupts until the
@@ -479,7 +562,7 @@ is_thread (struct thread *t)
 static void
 init_thread (struct thread *t, const char *name, int priority)
 {
-  enum intr_level old_level;
+  int i;
 
   ASSERT (t != NULL);
   ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
@@ -491,15 +574,12 @@ init_thread (struct thread *t, const char *name, int priority)
   t->stack = (uint8_t *) t + PGSIZE;
   t->priority = priority;
   t->magic = THREAD_MAGIC;
-  list_init(&t->opened_files);
-  list_init(&t->children);
+  for (i = 0; i < CHILD_BUCKETS; i++)
+    list_init(&t->children[i]);
   t->parent = NULL;
   list_init(&t->mmap_list);
+  list_init(&t->shm_list);
   t->mapid = 0;
-
-  old_level = intr_disable ();
-  list_push_back (&all_list, &t->allelem);
-  intr_set_level (old_level);
 }
 
 /* Allocates a SIZE-byte frame at the top of thread T's stack and
@@ -555,6 +635,14 @@ thread_schedule_tail (struct thread *prev)
   /* Mark us as running. */
   cur->status = THREAD_RUNNING;
 
+  /* Account for the time since we were woken up. */
+  if (cur->wakeup_tsc != 0)
+    {
+      histogram_add (&wakeup_latency[cur->priority],
+                     rdtsc () - cur->wakeup_tsc);
+      cur->wakeup_tsc = 0;
+    }
+
   /* Start new time slice. */
   thread_ticks = 0;
 
@@ -571,7 +659,13 @@ thread_schedule_tail (struct thread *prev)
   if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread) 
     {
       ASSERT (prev != cur);
-      palloc_free_page (prev);
+      if (thread_cache_cnt < THREAD_CACHE_MAX)
+        {
+          prev->magic = 0;
+          thread_cache[thread_cache_cnt++] = prev;
+        }
+      else
+        palloc_free_page (prev);
     }
 }
 
@@ -594,41 +688,82 @@ schedule (void)
   ASSERT (is_thread (next));
 
   if (cur != next)
-    prev = switch_threads (cur, next);
+    {
+      TRACE (TRACE_SWITCH, next->tid, cur->status, 0);
+      prev = switch_threads (cur, next);
+    }
   thread_schedule_tail (prev);
 }
 
-/* Returns a tid to use for a new thread. */
+/* Returns a tid to use for a new thread.  A single atomic
+   increment, so it takes no lock. */
 static tid_t
 allocate_tid (void) 
 {
   static tid_t next_tid = 1;
-  tid_t tid;
-
-  lock_acquire (&tid_lock);
-  tid = next_tid++;
-  lock_release (&tid_lock);
+  tid_t tid = 1;
 
+  asm volatile ("lock xaddl %0, %1" : "+r" (tid), "+m" (next_tid) : : "memory");
   return tid;
 }
 
+/* Returns a page for a new thread, from the cache of dead
+   threads' pages if possible, or a null pointer if memory is
+   short.  The page's contents are arbitrary. */
+static struct thread *
+alloc_thread_page (void)
+{
+  struct thread *t = NULL;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  create_cnt++;
+  if (thread_cache_cnt > 0)
+    {
+      t = thread_cache[--thread_cache_cnt];
+      cache_hits++;
+    }
+  intr_set_level (old_level);
+
+  return t != NULL ? t : palloc_get_page (0);
+}
+
+
+/* Adds T, whose tid must already be set, to all_list and the
+   TID table.  Interrupts must be off, except at boot. */
+static void
+add_thread (struct thread *t)
+{
+  list_push_back (&all_list, &t->allelem);
+  list_push_back (&tid_table[t->tid % TID_BUCKETS], &t->tidelem);
+}
 
+/* Returns the thread with the given TID, or a null pointer if
+   no such thread exists.  Only TID's bucket is searched, which
+   holds one thread in TID_BUCKETS on average, so it is cheap
+   enough to do with interrupts off. */
 struct thread *
 get_thread_by_tid(tid_t tid) {
+  struct thread *found = NULL;
+  struct list *bucket;
+  struct list_elem *e;
   enum intr_level old_level;
-  old_level = intr_disable();
 
-  struct list_elem *e = list_begin(&all_list);
-  for(; e != list_end(&all_list); e = list_next(e)) {
-    struct thread *t = list_entry(e, struct thread, elem);
+  if(tid <= 0)
+    return NULL;
+
+  bucket = &tid_table[tid % TID_BUCKETS];
+  old_level = intr_disable();
+  for(e = list_begin(bucket); e != list_end(bucket); e = list_next(e)) {
+    struct thread *t = list_entry(e, struct thread, tidelem);
     if(t->tid == tid) {
-      intr_set_level (old_level);
-      return t;
+      found = t;
+      break;
     }
   }
+  intr_set_level(old_level);
 
-  intr_set_level (old_level);
-  return NULL;
+  return found;
 }
 
 /* Offset of `stack' member within `struct thread'.
@@ -30,15 +30,27 @@ struct child_process
                       0: not loaded; -1: load failed; 1: load success. */
    struct semaphore sema_exec;  /* Semaphore used in sys_exec.*/
    struct semaphore sema_wait;  /* Semaphore used in sys_wait. */
-   struct list_elem elem;
+   struct list_elem elem;       /* Element in parent's children index. */
  };
 
+/* Number of buckets in each thread's index of its children.
+   A child is found in bucket pid % CHILD_BUCKETS. */
+#define CHILD_BUCKETS 8
+
+/* An open file or pipe end.  Several fd slots may share one,
+   in one process after dup2() or across processes after exec(),
+   and it is closed when the last of them is. */
 struct open_file {
-  struct file *file;
-  int fd;       /* file descriptor. */
-  struct list_elem elem;
+  struct file *file;    /* Open file, or null for a pipe end. */
+  struct pipe *pipe;    /* Pipe, or null for a file. */
+  bool writer;          /* For a pipe, true for its write end. */
+  int ref_cnt;          /* fd slots referring to this. */
 };
 
+/* Number of slots in a new file descriptor table.  The table
+   doubles whenever every slot is in use. */
+#define FD_TABLE_INIT 16
+
 /* Thread identifier type.
    You can redefine this to whatever type you like. */
 typedef int tid_t;
@@ -114,7 +126,9 @@ struct thread
     char name[16];                      /* Name (for debugging purposes). */
     uint8_t *stack;                     /* Saved stack pointer. */
     int priority;                       /* Priority. */
+    uint64_t wakeup_tsc;                /* TSC at last thread_unblock(). */
     struct list_elem allelem;           /* List element for all threads list. */
+    struct list_elem tidelem;           /* List element in TID table bucket. */
 
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */  
@@ -122,17 +136,24 @@ struct thread
     struct hash spt;  /* Supplemental page table. */
     struct list mmap_list;
     int mapid;
+    struct list shm_list;  /* Attached shared memory segments. */
+    uint8_t *heap_start;   /* First byte of the sbrk() heap. */
+    uint8_t *heap_brk;     /* End of the sbrk() heap. */
+    size_t locked_cnt;     /* Pages locked with mlock(). */
 
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;  /* Page directory. */
-    struct list opened_files; /*list of open_files that the thread is referencing*/
+    struct open_file **fds;   /* Open files indexed by fd, or null. */
+    size_t fd_cnt;            /* Number of slots in fds. */
+    struct bitmap *fd_map;    /* Slots of fds in use, 0 and 1 always. */
 
     struct thread *parent;              /* Parent thread. */
-    struct list children;               /* List of child_process. */
+    struct list children[CHILD_BUCKETS]; /* child_process, by pid. */
     
     struct child_process *self_child;   /* Self Status. */
     struct file *exec_file;            /* Executable file this thread opened. */
+    void *ring;                        /* I/O ring page, or null. */
 #endif
 
     /* Owned by thread.c. */
@@ -144,11 +165,18 @@ struct thread
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If false (default), record nothing.  If true, record the
+   wakeup latency and interrupts-off histograms printed by
+   thread_print_stats().  Controlled by kernel command-line
+   option "-latency". */
+extern bool thread_latency_stats;
+
 void thread_init (void);
 void thread_start (void);
 
 void thread_tick (void);
 void thread_print_stats (void);
+long long thread_idle_ticks (void);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
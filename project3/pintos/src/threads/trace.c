@@ -0,0 +1,143 @@
+#include "threads/trace.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <round.h>
+#include <stdio.h>
+#include "devices/serial.h"
+#include "devices/timer.h"
+#include "threads/io.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Event tracing.
+
+   Each tracepoint appends a fixed-size record stamped with the
+   time-stamp counter to a ring buffer allocated once at boot.
+   A writer claims its slot with a single atomic increment of
+   the head index and then fills it in, so tracepoints take no
+   lock, never disable interrupts, and may be used from
+   interrupt handlers.  When the ring is full the oldest events
+   are overwritten.
+
+   At shutdown the ring is written to the serial port as
+
+        Trace: begin EVENTS events, LOST lost, CYCLES cycles/tick, HZ Hz
+        ...EVENTS records of 24 bytes each, oldest first...
+        Trace: end
+
+   The records are raw binary, so they do not go to the VGA
+   console.  "trace-decode" reads them back and prints a
+   timeline. */
+
+/* One trace record, as written to the serial port. */
+struct trace_record
+  {
+    uint64_t tsc;               /* Time-stamp counter. */
+    uint16_t type;              /* An enum trace_type. */
+    uint16_t tid;               /* Running thread. */
+    uint32_t arg[3];            /* Type-specific arguments. */
+  };
+
+/* Ring size in pages if "-trace" does not give one. */
+#define DEFAULT_PAGE_CNT 64
+
+/* See trace.h. */
+bool trace_enabled;
+
+static struct trace_record *ring;       /* Ring buffer. */
+static uint32_t ring_mask;              /* Number of records - 1. */
+static uint32_t head;                   /* Records ever claimed. */
+static uint64_t boot_tsc;               /* TSC at trace_init(). */
+
+/* Allocates a ring of PAGE_CNT pages, or a default size if
+   PAGE_CNT is 0, if tracing was requested on the kernel command
+   line.  Must be called after palloc_init() and before
+   interrupts are enabled. */
+void
+trace_init (size_t page_cnt)
+{
+  size_t record_cnt;
+
+  if (!trace_enabled)
+    return;
+  if (page_cnt == 0)
+    page_cnt = DEFAULT_PAGE_CNT;
+
+  /* Use the largest power of 2 records that fit, so that a slot
+     is found with a mask instead of a division. */
+  record_cnt = page_cnt * PGSIZE / sizeof *ring;
+  while (record_cnt & (record_cnt - 1))
+    record_cnt &= record_cnt - 1;
+
+  ring = palloc_get_multiple (PAL_ZERO, page_cnt);
+  if (ring == NULL)
+    PANIC ("trace: could not allocate %zu pages", page_cnt);
+  ring_mask = record_cnt - 1;
+  boot_tsc = rdtsc ();
+}
+
+/* Appends an event of the given TYPE with arguments A, B, and C
+   to the ring.  Use the TRACE macro instead of calling this
+   directly. */
+void
+trace_event (enum trace_type type, uint32_t a, uint32_t b, uint32_t c)
+{
+  struct trace_record *r;
+  struct thread *t;
+  uint32_t slot = 1;
+
+  if (ring == NULL)
+    return;
+
+  /* Claim a slot.  Anything that interrupts us claims a later
+     one, so no event is ever written twice. */
+  asm volatile ("lock xaddl %0, %1" : "+r" (slot), "+m" (head) : : "memory");
+
+  /* This is running_thread(), which is private to thread.c.
+     thread_current() would reject a thread inside schedule(),
+     whose status is no longer THREAD_RUNNING. */
+  asm ("mov %%esp, %0" : "=g" (t));
+  t = pg_round_down (t);
+
+  r = &ring[slot & ring_mask];
+  r->tsc = rdtsc ();
+  r->type = type;
+  r->tid = t->tid;
+  r->arg[0] = a;
+  r->arg[1] = b;
+  r->arg[2] = c;
+}
+
+/* Writes the ring to the serial port, oldest event first.
+   Tracing stops here, so events from shutdown itself are not
+   recorded. */
+void
+trace_print_stats (void)
+{
+  uint32_t end, cnt, i;
+  int64_t ticks;
+  uint64_t cycles_per_tick;
+
+  if (ring == NULL)
+    return;
+  trace_enabled = false;
+
+  end = head;
+  cnt = end < ring_mask + 1 ? end : ring_mask + 1;
+  ticks = timer_ticks ();
+  cycles_per_tick = ticks > 0 ? (rdtsc () - boot_tsc) / ticks : 0;
+
+  printf ("Trace: begin %"PRIu32" events, %"PRIu32" lost, "
+          "%"PRIu64" cycles/tick, %d Hz\n",
+          cnt, end - cnt, cycles_per_tick, TIMER_FREQ);
+  for (i = end - cnt; i != end; i++)
+    {
+      const uint8_t *p = (const uint8_t *) &ring[i & ring_mask];
+      size_t j;
+
+      for (j = 0; j < sizeof *ring; j++)
+        serial_putc (p[j]);
+    }
+  printf ("Trace: end\n");
+}
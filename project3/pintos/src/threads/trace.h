@@ -0,0 +1,61 @@
+#ifndef THREADS_TRACE_H
+#define THREADS_TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Kinds of trace events.  The meaning of each event's three
+   arguments is given in its comment.  utils/trace-decode knows
+   these numbers, so only append to this list. */
+enum trace_type
+  {
+    TRACE_SWITCH,               /* Context switch: next tid, old status. */
+    TRACE_BLOCK,                /* Running thread blocks. */
+    TRACE_UNBLOCK,              /* Thread unblocked: tid. */
+    TRACE_PAGE_FAULT,           /* Page fault: address, eip, error code. */
+    TRACE_FAULT_DONE,           /* Fault resolved: address, enum trace_fault. */
+    TRACE_SWAP_IN,              /* Swap in: slot, user page. */
+    TRACE_SWAP_OUT,             /* Swap out: slot, user page. */
+    TRACE_BLOCK_ISSUE,          /* Block I/O start: sector, device type,
+                                   sector count << 1 | write?. */
+    TRACE_BLOCK_DONE,           /* Block I/O done: as TRACE_BLOCK_ISSUE. */
+    TRACE_SYSCALL,              /* System call entry: number. */
+    TRACE_SYSCALL_EXIT,         /* System call return: number, eax. */
+    TRACE_TYPE_CNT
+  };
+
+/* How a page fault was resolved, for TRACE_FAULT_DONE. */
+enum trace_fault
+  {
+    TRACE_FAULT_FILE,           /* Read in from a file. */
+    TRACE_FAULT_ZERO,           /* Zero-filled. */
+    TRACE_FAULT_SWAP,           /* Read back from swap. */
+    TRACE_FAULT_STACK,          /* New stack page. */
+    TRACE_FAULT_PRESENT,        /* Already loaded. */
+    TRACE_FAULT_FAIL            /* Not resolved; process killed. */
+  };
+
+/* If false (default), tracepoints cost a load and a branch and
+   record nothing.  If true, each tracepoint appends an event to
+   a ring buffer that is written to the serial port in binary at
+   shutdown.  Controlled by kernel command-line option
+   "-trace[=PAGES]". */
+extern bool trace_enabled;
+
+/* Records an event of the given TYPE with arguments A, B, and C,
+   if tracing is enabled. */
+#define TRACE(TYPE, A, B, C)                                            \
+        do                                                              \
+          {                                                             \
+            if (trace_enabled)                                          \
+              trace_event (TYPE, (uint32_t) (A), (uint32_t) (B),        \
+                           (uint32_t) (C));                             \
+          }                                                             \
+        while (0)
+
+void trace_init (size_t page_cnt);
+void trace_event (enum trace_type, uint32_t a, uint32_t b, uint32_t c);
+void trace_print_stats (void);
+
+#endif /* threads/trace.h */
@@ -4,7 +4,9 @@
 #include "userprog/gdt.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #include "userprog/syscall.h"
+#include "userprog/sysenter.h"
 #include "threads/vaddr.h"
 #include "vm/page.h"
 
@@ -14,6 +16,7 @@
 static long long page_fault_cnt;
 
 static void kill (struct intr_frame *);
+static void debug_exception (struct intr_frame *);
 static void page_fault (struct intr_frame *);
 
 /* Registers handlers for interrupts that can be caused by user
@@ -48,7 +51,8 @@ exception_init (void)
      caused indirectly, e.g. #DE can be caused by dividing by
      0.  */
   intr_register_int (0, 0, INTR_ON, kill, "#DE Divide Error");
-  intr_register_int (1, 0, INTR_ON, kill, "#DB Debug Exception");
+  intr_register_int (1, 0, INTR_ON, debug_exception,
+                     "#DB Debug Exception");
   intr_register_int (6, 0, INTR_ON, kill, "#UD Invalid Opcode Exception");
   intr_register_int (7, 0, INTR_ON, kill,
                      "#NM Device Not Available Exception");
@@ -113,6 +117,17 @@ kill (struct intr_frame *f)
     }
 }
 
+/* Debug exception handler.  A process that single-steps into
+   "sysenter" traps on the first instruction of the kernel's
+   entry point, which is harmless; anything else is treated like
+   other exceptions. */
+static void
+debug_exception (struct intr_frame *f) 
+{
+  if (!sysenter_debug (f))
+    kill (f);
+}
+
 /* Page fault handler.  This is a skeleton that must be filled in
    to implement virtual memory.  Some solutions to project 2 may
    also require modifying this code.
@@ -140,6 +155,7 @@ page_fault (struct intr_frame *f)
      [IA32-v3a] 5.15 "Interrupt 14--Page Fault Exception
      (#PF)". */
   asm ("movl %%cr2, %0" : "=r" (fault_addr));
+  TRACE (TRACE_PAGE_FAULT, fault_addr, f->eip, f->error_code);
 
   /* Turn interrupts back on (they were only off so that we could
      be assured of reading CR2 before it changed). */
@@ -155,18 +171,30 @@ page_fault (struct intr_frame *f)
 
     
   bool load = false;
+  enum trace_fault how = TRACE_FAULT_FAIL;
   if(not_present && fault_addr != NULL
      && fault_addr >= USER_VADDR_BOTTOM
      && is_user_vaddr(fault_addr)) {
     struct spt_entry *spte = get_spte(fault_addr);
     if(spte){
+      // Classify before load_page() changes the entry.
+      if(spte->loaded)
+        how = TRACE_FAULT_PRESENT;
+      else if(spte->swap)
+        how = TRACE_FAULT_SWAP;
+      else if(spte->read_bytes == 0)
+        how = TRACE_FAULT_ZERO;
+      else
+        how = TRACE_FAULT_FILE;
       load = load_page(spte);
       spte->pinned = false;
     }
     else if(f->esp - fault_addr <= 32){
+      how = TRACE_FAULT_STACK;
       load = grow_stack(fault_addr);
     }
   }
+  TRACE (TRACE_FAULT_DONE, fault_addr, load ? how : TRACE_FAULT_FAIL, 0);
 
   if(!load) {
     if(user && !is_user_vaddr(fault_addr)){
@@ -0,0 +1,164 @@
+#include "userprog/pipe.h"
+#include <debug.h>
+#include <stdint.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* A pipe: a one-page ring buffer with a read end and a write
+   end.
+
+   Readers block while the ring is empty and writers while it is
+   full, on condition variables under the pipe's lock.  A read
+   returns as soon as any data is available, or 0 at end of file,
+   once the write end is closed and the ring has drained.  A
+   write blocks until all of its data is in the ring, and fails
+   once the read end is closed. */
+struct pipe
+  {
+    struct lock lock;           /* Protects all the members below. */
+    struct condition not_empty; /* Signaled when data arrives. */
+    struct condition not_full;  /* Signaled when space frees up. */
+    uint8_t *ring;              /* PIPE_SIZE bytes of data. */
+    uint32_t head;              /* Bytes ever written. */
+    uint32_t tail;              /* Bytes ever read. */
+    bool reader_open;           /* Read end still open? */
+    bool writer_open;           /* Write end still open? */
+  };
+
+/* Bytes in a pipe's ring.  A power of 2, so that the head and
+   tail counters may simply wrap around. */
+#define PIPE_SIZE PGSIZE
+
+/* Creates and returns a new pipe with both ends open, or a null
+   pointer if memory is short. */
+struct pipe *
+pipe_create (void)
+{
+  struct pipe *p = malloc (sizeof *p);
+  if (p == NULL)
+    return NULL;
+
+  p->ring = palloc_get_page (0);
+  if (p->ring == NULL)
+    {
+      free (p);
+      return NULL;
+    }
+  lock_init (&p->lock);
+  cond_init (&p->not_empty);
+  cond_init (&p->not_full);
+  p->head = p->tail = 0;
+  p->reader_open = p->writer_open = true;
+  return p;
+}
+
+/* Reads up to SIZE bytes from pipe P into BUFFER, waiting until
+   at least one byte is available.  Returns the number of bytes
+   read, or 0 if the write end is closed and P is empty. */
+int
+pipe_read (struct pipe *p, void *buffer_, size_t size)
+{
+  uint8_t *buffer = buffer_;
+  size_t bytes_read = 0;
+
+  if (size == 0)
+    return 0;
+
+  lock_acquire (&p->lock);
+  while (p->head == p->tail && p->writer_open)
+    cond_wait (&p->not_empty, &p->lock);
+
+  while (bytes_read < size && p->tail != p->head)
+    {
+      /* Copy the longest run that neither wraps around the ring
+         nor goes past the data written so far. */
+      size_t ofs = p->tail % PIPE_SIZE;
+      size_t chunk = p->head - p->tail;
+      if (chunk > PIPE_SIZE - ofs)
+        chunk = PIPE_SIZE - ofs;
+      if (chunk > size - bytes_read)
+        chunk = size - bytes_read;
+
+      memcpy (buffer + bytes_read, p->ring + ofs, chunk);
+      p->tail += chunk;
+      bytes_read += chunk;
+    }
+  cond_broadcast (&p->not_full, &p->lock);
+  lock_release (&p->lock);
+
+  return bytes_read;
+}
+
+/* Writes SIZE bytes from BUFFER to pipe P, waiting for readers
+   to make room as often as needed.  Returns SIZE, or -1 if the
+   read end is or becomes closed first, in which case some of
+   the data may already have been written. */
+int
+pipe_write (struct pipe *p, const void *buffer_, size_t size)
+{
+  const uint8_t *buffer = buffer_;
+  size_t bytes_written = 0;
+  int result;
+
+  lock_acquire (&p->lock);
+  while (bytes_written < size && p->reader_open)
+    {
+      size_t ofs, chunk;
+
+      if (p->head - p->tail == PIPE_SIZE)
+        {
+          cond_wait (&p->not_full, &p->lock);
+          continue;
+        }
+
+      ofs = p->head % PIPE_SIZE;
+      chunk = PIPE_SIZE - (p->head - p->tail);
+      if (chunk > PIPE_SIZE - ofs)
+        chunk = PIPE_SIZE - ofs;
+      if (chunk > size - bytes_written)
+        chunk = size - bytes_written;
+
+      memcpy (p->ring + ofs, buffer + bytes_written, chunk);
+      p->head += chunk;
+      bytes_written += chunk;
+      cond_broadcast (&p->not_empty, &p->lock);
+    }
+  result = bytes_written == size ? (int) size : -1;
+  lock_release (&p->lock);
+
+  return result;
+}
+
+/* Closes the write end of pipe P if WRITER is true, otherwise
+   its read end, waking anyone waiting on the other end.  Frees
+   P once both ends are closed. */
+void
+pipe_close (struct pipe *p, bool writer)
+{
+  bool destroy;
+
+  lock_acquire (&p->lock);
+  if (writer)
+    {
+      ASSERT (p->writer_open);
+      p->writer_open = false;
+      cond_broadcast (&p->not_empty, &p->lock);
+    }
+  else
+    {
+      ASSERT (p->reader_open);
+      p->reader_open = false;
+      cond_broadcast (&p->not_full, &p->lock);
+    }
+  destroy = !p->reader_open && !p->writer_open;
+  lock_release (&p->lock);
+
+  if (destroy)
+    {
+      palloc_free_page (p->ring);
+      free (p);
+    }
+}
@@ -5,9 +5,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time-page.h>
 #include "userprog/gdt.h"
 #include "userprog/pagedir.h"
 #include "userprog/tss.h"
+#include "devices/timer.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
@@ -21,12 +23,12 @@
 #include "userprog/syscall.h"
 #include "vm/page.h"
 #include "vm/frame.h"
+#include "vm/shm.h"
 #include "vm/swap.h"
 
 static thread_func start_process NO_RETURN;
 static bool load (const char *cmdline, void (**eip) (void), void **esp);
 
-struct child_process *get_child_process(struct thread *t, tid_t tid);
 
 /* Starts a new thread running a user program loaded from
    FILENAME.  The new thread may be scheduled (and may even exit)
@@ -79,6 +81,10 @@ start_process (void *file_name_)
   
   success = load (file_name, &if_.eip, &if_.esp);  
   
+  /* Take over the parent's fds, pipes included. */
+  if (success)
+    success = fd_table_inherit(t, t->parent);
+
   /* If load failed, quit. */
   if (!success) {
     
@@ -144,12 +150,18 @@ process_wait (tid_t child_tid UNUSED)
   
 }
 
-/* Get child thread with the given tid. */
+/* Get child thread with the given tid.  Only the children
+   hashed to TID's bucket are searched. */
 struct child_process *
 get_child_process(struct thread *t, tid_t tid) {
-  struct list_elem *e = list_begin(&t->children);
-  
-  for(;e!=list_end(&t->children); e=list_next(e)) {
+  struct list *bucket;
+  struct list_elem *e;
+
+  if(tid < 0)
+    return NULL;
+
+  bucket = &t->children[tid % CHILD_BUCKETS];
+  for(e = list_begin(bucket); e != list_end(bucket); e = list_next(e)) {
     struct child_process *cp = list_entry(e, struct child_process, elem);
     if(cp->pid == tid) {
       return cp;
@@ -165,6 +177,7 @@ process_exit (void)
 {
   struct thread *cur = thread_current ();
   uint32_t *pd;
+  int i;
 
   /* Destroy the current process's page directory and switch back
      to the kernel-only page directory. */
@@ -191,21 +204,21 @@ process_exit (void)
       }
 
       /* Free child processes. */
-      while(!list_empty(&cur->children)) {
-        struct list_elem *child = list_pop_front(&cur->children);
-      	struct child_process *cp= list_entry(child, struct child_process, elem);
-        free(cp);
+      for(i = 0; i < CHILD_BUCKETS; i++) {
+        while(!list_empty(&cur->children[i])) {
+          struct list_elem *child = list_pop_front(&cur->children[i]);
+          struct child_process *cp= list_entry(child, struct child_process, elem);
+          free(cp);
+        }
       }
 
+      /* Detach shared memory. */
+      shm_detach_all();
+
       hash_destroy(&cur->spt, page_action_func);
 
       /* Free opened files. */
-      while(!list_empty(&cur->opened_files)) {
-        struct list_elem *e = list_pop_front(&cur->opened_files);
-      	struct open_file *of= list_entry(e, struct open_file, elem);
-	file_close(of->file);
-	free(of);
-      }
+      fd_table_destroy(cur);
 
       /* Close executable file. */
       if(cur->exec_file != NULL) {
@@ -216,6 +229,9 @@ process_exit (void)
       printf ("%s: exit(%d)\n", cur->name, cur->self_child->status);
       cur->pagedir = NULL;
       pagedir_activate (NULL);
+
+      /* The time page is shared, so it must not be freed. */
+      pagedir_clear_page (pd, TIME_PAGE_ADDR);
       pagedir_destroy (pd);
     }
 }
@@ -319,12 +335,20 @@ load (const char *file_name, void (**eip) (void), void **esp)
   bool success = false;
   int i;
 
+  /* The heap starts empty, just above the highest segment. */
+  t->heap_start = t->heap_brk = NULL;
+
   /* Allocate and activate page directory. */
   t->pagedir = pagedir_create ();
   if (t->pagedir == NULL) 
     goto done;
   process_activate ();
 
+  /* Map the time page, read-only. */
+  if (!pagedir_set_page (t->pagedir, TIME_PAGE_ADDR, timer_time_page (),
+                         false))
+    goto done;
+
   const char *fn_copy;
   fn_copy = palloc_get_page(0);
   strlcpy(fn_copy, file_name, PGSIZE);
@@ -408,6 +432,10 @@ load (const char *file_name, void (**eip) (void), void **esp)
               if (!load_segment (file, file_page, (void *) mem_page,
                                  read_bytes, zero_bytes, writable))
                 goto done;
+              if ((uint8_t *) mem_page + read_bytes + zero_bytes
+                  > t->heap_start)
+                t->heap_start = t->heap_brk
+                  = (uint8_t *) mem_page + read_bytes + zero_bytes;
             }
           else
             goto done;
@@ -8,5 +8,6 @@ int process_wait (tid_t);
 void process_exit (void);
 void process_activate (void);
 bool install_page (void *upage, void *kpage, bool writable);
+struct child_process *get_child_process (struct thread *, tid_t);
 
 #endif /* userprog/process.h */
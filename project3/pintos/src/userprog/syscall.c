@@ -1,19 +1,42 @@
 #include "userprog/syscall.h"
+#include <bitmap.h>
+#include <io-ring.h>
 #include <stdio.h>
 #include <syscall-nr.h>
+#include <limits.h>
+#include <round.h>
 #include <string.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "devices/shutdown.h"
 #include "threads/malloc.h"
 #include "userprog/process.h"
 #include "userprog/pagedir.h"
+#include "userprog/pipe.h"
+#include "userprog/sysenter.h"
 #include "devices/input.h"
+#include "threads/palloc.h"
+#include "vm/frame.h"
 #include "vm/page.h"
+#include "vm/shm.h"
+#include "vm/swap.h"
+
+/* One user buffer for readv and writev.  Must match struct
+   iovec in lib/user/syscall.h. */
+struct iovec
+  {
+    void *iov_base;             /* Start of buffer. */
+    size_t iov_len;             /* Length of buffer in bytes. */
+  };
+
+/* Most buffers accepted by one readv or writev, as IOV_MAX in
+   lib/user/syscall.h. */
+#define IOV_MAX 1024
 
 static void syscall_handler (struct intr_frame *f UNUSED);
 void get_arguments (struct intr_frame *f, int *arg, int n);
@@ -26,6 +49,12 @@ bool create (const char *file, unsigned initial_size);
 bool remove (const char *file);
 int open (const char *file);
 struct open_file * get_open_file_by_fd(struct thread *t, int descriptor);
+static int allocate_fd(struct thread *t, struct open_file *of);
+static struct open_file *new_open_file(struct file *, struct pipe *,
+                                       bool writer);
+static void release_open_file(struct open_file *);
+bool pipe (int *fds);
+int dup2 (int old_fd, int new_fd);
 void close (int fd);
 int write (int fd, const void *buffer, unsigned size);
 int read (int fd, void *buffer, unsigned size);
@@ -36,6 +65,26 @@ bool is_valid_ptr(const void *user_ptr, struct intr_frame *f);
 void check_buffer(const void *buffer, unsigned size, struct intr_frame *f);
 void check_writable(const void *buffer, unsigned size, struct intr_frame *f);
 int mmap(int fd, void *addr);
+int mmap_anon(void *addr, unsigned size);
+void *sbrk(intptr_t increment);
+bool msync(void *addr, unsigned length);
+bool madvise(void *addr, unsigned length, int advice);
+bool mlock(const void *addr, unsigned length);
+bool munlock(const void *addr, unsigned length);
+bool ring_setup(void *addr);
+int ring_enter(unsigned to_submit, struct intr_frame *f);
+static int ring_execute(const struct io_ring_sqe *sqe, struct intr_frame *f);
+static bool range_mapped(void *addr, unsigned length);
+static void writeback_page(struct spt_entry *spte);
+static void discard_page(struct spt_entry *spte);
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+int pread (int fd, void *buffer, unsigned size, unsigned offset);
+int pwrite (int fd, const void *buffer, unsigned size, unsigned offset);
+int copy_file_range (int in_fd, unsigned in_offset,
+                     int out_fd, unsigned out_offset, unsigned size);
+static bool check_iovec(const struct iovec *iov, int iovcnt, bool writable,
+                        struct intr_frame *f);
 
 static struct lock file_lock;
 
@@ -43,7 +92,9 @@ void
 syscall_init (void) 
 {
   lock_init(&file_lock); //init file_lock;
+  lock_profile(&file_lock, "file_lock");
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
+  sysenter_init ();
 }
 
 static void
@@ -57,7 +108,9 @@ syscall_handler (struct intr_frame *f UNUSED)
      https://github.com/ryantimwilson/Pintos-Project-2/blob
      /master/src/userprog/syscall.c*/
   int arg[5];
-  switch(* (int *) f->esp) {
+  int call = * (int *) f->esp;
+  TRACE (TRACE_SYSCALL, call, 0, 0);
+  switch(call) {
     case SYS_HALT:{
       halt();
       break;
@@ -137,10 +190,126 @@ syscall_handler (struct intr_frame *f UNUSED)
       munmap(arg[0]);
       break;
     }
+    case SYS_READV: {
+      get_arguments(f, &arg[0], 3);
+      if(!check_iovec((const struct iovec *) arg[1], arg[2], true, f))
+        f->eax = -1;
+      else
+        f->eax = readv(arg[0], (const struct iovec *) arg[1], arg[2]);
+      break;
+    }
+    case SYS_WRITEV: {
+      get_arguments(f, &arg[0], 3);
+      if(!check_iovec((const struct iovec *) arg[1], arg[2], false, f))
+        f->eax = -1;
+      else
+        f->eax = writev(arg[0], (const struct iovec *) arg[1], arg[2]);
+      break;
+    }
+    case SYS_PREAD: {
+      get_arguments(f, &arg[0], 4);
+      check_buffer((const void *) arg[1], (unsigned) arg[2], f);
+      check_writable((const void *) arg[1], (unsigned) arg[2], f);
+      f->eax = pread(arg[0], (void *) arg[1], arg[2], arg[3]);
+      break;
+    }
+    case SYS_PWRITE: {
+      get_arguments(f, &arg[0], 4);
+      check_buffer((const void *) arg[1], (unsigned) arg[2], f);
+      f->eax = pwrite(arg[0], (const void *) arg[1], arg[2], arg[3]);
+      break;
+    }
+    case SYS_PIPE: {
+      get_arguments(f, &arg[0], 1);
+      check_buffer((const void *) arg[0], 2 * sizeof (int), f);
+      check_writable((const void *) arg[0], 2 * sizeof (int), f);
+      f->eax = pipe((int *) arg[0]);
+      break;
+    }
+    case SYS_DUP2: {
+      get_arguments(f, &arg[0], 2);
+      f->eax = dup2(arg[0], arg[1]);
+      break;
+    }
+    case SYS_SHM_CREATE: {
+      get_arguments(f, &arg[0], 2);
+      f->eax = shm_create(arg[0], (unsigned) arg[1]);
+      break;
+    }
+    case SYS_SHM_REMOVE: {
+      get_arguments(f, &arg[0], 1);
+      f->eax = shm_remove(arg[0]);
+      break;
+    }
+    case SYS_SHM_ATTACH: {
+      get_arguments(f, &arg[0], 2);
+      f->eax = (uint32_t) shm_attach(arg[0], (void *) arg[1]);
+      break;
+    }
+    case SYS_SHM_DETACH: {
+      get_arguments(f, &arg[0], 1);
+      f->eax = shm_detach((void *) arg[0]);
+      break;
+    }
+    case SYS_COPY_FILE_RANGE: {
+      get_arguments(f, &arg[0], 5);
+      f->eax = copy_file_range(arg[0], arg[1], arg[2], arg[3], arg[4]);
+      break;
+    }
+    case SYS_SBRK: {
+      get_arguments(f, &arg[0], 1);
+      f->eax = (uint32_t) sbrk(arg[0]);
+      break;
+    }
+    case SYS_MMAP_ANON: {
+      get_arguments(f, &arg[0], 2);
+      f->eax = mmap_anon((void *) arg[0], (unsigned) arg[1]);
+      break;
+    }
+    case SYS_MSYNC: {
+      get_arguments(f, &arg[0], 2);
+      f->eax = msync((void *) arg[0], (unsigned) arg[1]);
+      break;
+    }
+    case SYS_MADVISE: {
+      get_arguments(f, &arg[0], 3);
+      f->eax = madvise((void *) arg[0], (unsigned) arg[1], arg[2]);
+      break;
+    }
+    case SYS_MLOCK: {
+      get_arguments(f, &arg[0], 2);
+      f->eax = mlock((const void *) arg[0], (unsigned) arg[1]);
+      break;
+    }
+    case SYS_MUNLOCK: {
+      get_arguments(f, &arg[0], 2);
+      f->eax = munlock((const void *) arg[0], (unsigned) arg[1]);
+      break;
+    }
+    case SYS_RING_SETUP: {
+      get_arguments(f, &arg[0], 1);
+      f->eax = ring_setup((void *) arg[0]);
+      break;
+    }
+    case SYS_RING_ENTER: {
+      get_arguments(f, &arg[0], 1);
+      f->eax = ring_enter((unsigned) arg[0], f);
+      break;
+    }
+    case SYS_NULL: {
+      // Nothing to do; only the cost of getting here and back.
+      f->eax = 0;
+      break;
+    }
+    case SYS_SYSENTER: {
+      f->eax = sysenter_enabled;
+      break;
+    }
   }
   struct spt_entry *spte = get_spte(f->esp);
   if(spte)
     spte->pinned = false;
+  TRACE (TRACE_SYSCALL_EXIT, call, f->eax, 0);
 }
 
 
@@ -181,6 +350,34 @@ check_writable(const void *buffer, unsigned size, struct intr_frame *f) {
 }
 
 
+/* Checks the IOVCNT-element array IOV and every buffer it
+   points to, in one pass before any I/O is done, killing the
+   process if any of them is bad.  If WRITABLE, the buffers must
+   also be writable.  Returns false, without killing the process,
+   if IOVCNT is out of range or the buffers add up to more bytes
+   than an int can count. */
+static bool
+check_iovec(const struct iovec *iov, int iovcnt, bool writable,
+            struct intr_frame *f) {
+  size_t total = 0;
+  int i;
+
+  if(iovcnt < 0 || iovcnt > IOV_MAX)
+    return false;
+  check_buffer(iov, iovcnt * sizeof *iov, f);
+
+  for(i = 0; i < iovcnt; i++) {
+    if(iov[i].iov_len > INT_MAX - total)
+      return false;
+    total += iov[i].iov_len;
+    check_buffer(iov[i].iov_base, iov[i].iov_len, f);
+    if(writable)
+      check_writable(iov[i].iov_base, iov[i].iov_len, f);
+  }
+  return true;
+}
+
+
 /* Mapping user virtual address to kernel address. */
 int get_kernel_ptr(const void *vaddr)
 {
@@ -219,31 +416,27 @@ exec (const char *cmd_line) {
 
   /* Get execute cmd_line and call process_execute to exec it. */
   char *copyfile = (char *)malloc(sizeof(char) *(strlen(cmd_line)+1));
+  if(copyfile == NULL)
+    return -1;
   memcpy(copyfile, cmd_line, strlen(cmd_line)+1);
   pid_t pid = process_execute(copyfile);
+  // process_execute() keeps its own copy of the command line.
+  free(copyfile);
 
-  struct thread *t = thread_current();
-  struct list_elem *e = list_begin(&t->children);
+  struct child_process *cp = get_child_process(thread_current(), pid);
 
-  /* Wait all the child processes finish their loading. */
-  for( ; e != list_end(&t->children); e = list_next(e)) {
-    struct child_process *cp = list_entry(e, struct child_process, elem);
+  /* Wait for the child to finish loading.  If the executable file
+     has been loaded, sema_exec will be sema_up, then the process
+     can be continued. */
+  if(cp == NULL)
+    return -1;
+  if(cp->loaded == 0)
+    sema_down(&cp->sema_exec);
 
-    if (cp->loaded == 0) {
-      /* Wait for the sema_exec. If the executable file has been
-         loaded, sema_exec will be sema_up, then the process can 
-         be continued. */
-      sema_down(&cp->sema_exec);
-    }
+  /* File load failed. */
+  if(cp->loaded == -1)
+    return -1;
 
-    /* File load failed. */
-    if(cp->loaded == -1) {
-      return -1;
-    }
-  }
-  
-  free(copyfile);
-    
   return pid;
 }
 
@@ -290,56 +483,236 @@ open (const char *file)
   lock_acquire(&file_lock);
   struct file *f = filesys_open(file);
   lock_release(&file_lock);
+  if(f == NULL)
+    return -1;
+
   struct thread *cur = thread_current();
-  struct open_file *holder = (struct open_file *)malloc(sizeof(struct open_file));
-  holder->file = f;
-
-  /* Set the fd. Every time it is opened_files length puls 2. 
-     Make sure every file has different fd. */
-  int size = list_size(&cur->opened_files);
-  if(size == 0)
-    holder->fd = 2;
-  else {
-    struct list_elem *e = list_back (&cur->opened_files);
-    
-    struct open_file *of= list_entry(e, struct open_file, elem);
-    holder->fd = of->fd + 2;
+  struct open_file *holder = new_open_file(f, NULL, false);
+  int fd = holder != NULL ? allocate_fd(cur, holder) : -1;
+  if(fd == -1) {
+    free(holder);
+    lock_acquire(&file_lock);
+    file_close(f);
+    lock_release(&file_lock);
   }
-  //holder->fd = 2 + list_size(&cur->opened_files);
-  
-  
-  if (f != NULL)
-  {
-    /* Add file to the list. */
-    list_push_back(&cur->opened_files, &holder->elem);
-    return holder->fd;
+  return fd;
+}
+
+
+/* Syscall pipe.  Creates a pipe and stores fds for its read and
+   write ends in FDS[0] and FDS[1].  Returns false if memory is
+   short. */
+bool
+pipe (int *fds)
+{
+  struct thread *cur = thread_current();
+  struct pipe *p = pipe_create();
+  struct open_file *read_end, *write_end;
+  int read_fd = -1, write_fd;
+
+  if(p == NULL)
+    return false;
+  read_end = new_open_file(NULL, p, false);
+  write_end = new_open_file(NULL, p, true);
+  if(read_end != NULL && write_end != NULL
+     && (read_fd = allocate_fd(cur, read_end)) != -1
+     && (write_fd = allocate_fd(cur, write_end)) != -1) {
+    fds[0] = read_fd;
+    fds[1] = write_fd;
+    return true;
+  }
+
+  /* Undo whatever was done.  The pipe goes away with its second
+     end. */
+  if(read_fd != -1) {
+    cur->fds[read_fd] = NULL;
+    bitmap_reset(cur->fd_map, read_fd);
   }
-  else    
+  free(read_end);
+  free(write_end);
+  pipe_close(p, false);
+  pipe_close(p, true);
+  return false;
+}
+
+
+/* Syscall dup2.  Makes NEW_FD refer to whatever OLD_FD refers to,
+   closing NEW_FD first if it was open.  NEW_FD may be 0 or 1 to
+   redirect the console; closing it again restores the console.
+   Returns NEW_FD, or -1 if OLD_FD is not open or NEW_FD is
+   beyond the fd table. */
+int
+dup2 (int old_fd, int new_fd)
+{
+  struct thread *cur = thread_current();
+  struct open_file *of = get_open_file_by_fd(cur, old_fd);
+
+  if(of == NULL || new_fd < 0 || (size_t) new_fd >= cur->fd_cnt)
     return -1;
+  if(old_fd == new_fd)
+    return new_fd;
+
+  lock_acquire(&file_lock);
+  if(cur->fds[new_fd] != NULL)
+    release_open_file(cur->fds[new_fd]);
+  else
+    bitmap_mark(cur->fd_map, new_fd);
+  of->ref_cnt++;
+  cur->fds[new_fd] = of;
+  lock_release(&file_lock);
+  return new_fd;
 }
 
 
-/*iterates through the file_list of the current thread, returning the first
-file in the list whose fd = the given int. if there is no such fd, returns
-null.
-*/
-struct open_file *
-get_open_file_by_fd(struct thread *t, int descriptor)
+/* Returns a new open_file for FILE or for the read or write end,
+   according to WRITER, of pipe P, with a reference count of 1,
+   or a null pointer if memory is short. */
+static struct open_file *
+new_open_file(struct file *file, struct pipe *p, bool writer)
 {
-  struct list_elem *temp = list_begin (&t->opened_files);
-  for (; temp != list_end (&t->opened_files); temp = list_next (temp))
-  {
-    struct open_file *of= list_entry(temp, struct open_file, elem);
-    if (of->fd == descriptor)
-    {
-      return of;
+  struct open_file *of = malloc(sizeof *of);
+  if(of != NULL) {
+    of->file = file;
+    of->pipe = p;
+    of->writer = writer;
+    of->ref_cnt = 1;
+  }
+  return of;
+}
+
+
+/* Drops one reference to OF, closing its file or pipe end and
+   freeing it when the last one goes.  The caller must hold
+   file_lock. */
+static void
+release_open_file(struct open_file *of)
+{
+  ASSERT(lock_held_by_current_thread(&file_lock));
+
+  if(--of->ref_cnt > 0)
+    return;
+  if(of->pipe != NULL)
+    pipe_close(of->pipe, of->writer);
+  else
+    file_close(of->file);
+  free(of);
+}
+
+
+/* Puts OF in the lowest free slot of T's fd table, growing the
+   table if it is full.  Returns the fd, or -1 if memory ran
+   out. */
+static int
+allocate_fd(struct thread *t, struct open_file *of)
+{
+  size_t fd = BITMAP_ERROR;
+
+  if(t->fd_map != NULL)
+    fd = bitmap_scan_and_flip(t->fd_map, 0, 1, false);
+
+  if(fd == BITMAP_ERROR) {
+    /* Every slot is taken: double the table.  0 and 1 stay
+       marked so that they are never handed out. */
+    size_t new_cnt = t->fd_cnt ? t->fd_cnt * 2 : FD_TABLE_INIT;
+    struct open_file **fds = realloc(t->fds, new_cnt * sizeof *fds);
+    struct bitmap *map = bitmap_create(new_cnt);
+    size_t i;
+
+    if(fds == NULL || map == NULL) {
+      if(fds != NULL)
+        t->fds = fds;
+      bitmap_destroy(map);
+      return -1;
     }
+    for(i = t->fd_cnt; i < new_cnt; i++)
+      fds[i] = NULL;
+    bitmap_set_multiple(map, 0, t->fd_cnt ? t->fd_cnt : 2, true);
+    bitmap_destroy(t->fd_map);
+
+    fd = t->fd_cnt ? t->fd_cnt : 2;
+    bitmap_mark(map, fd);
+    t->fds = fds;
+    t->fd_map = map;
+    t->fd_cnt = new_cnt;
+  }
+
+  t->fds[fd] = of;
+  return fd;
+}
+
+
+/* Gives CHILD a copy of PARENT's fd table, so that the child
+   shares each of its parent's open files and pipe ends under the
+   same fd.  PARENT must not change its table meanwhile, which
+   exec() ensures by waiting for the child to load.  Returns
+   false if memory is short. */
+bool
+fd_table_inherit (struct thread *child, struct thread *parent)
+{
+  size_t i;
+
+  if(parent == NULL || parent->fd_cnt == 0)
+    return true;
+
+  child->fds = malloc(parent->fd_cnt * sizeof *child->fds);
+  child->fd_map = bitmap_create(parent->fd_cnt);
+  if(child->fds == NULL || child->fd_map == NULL) {
+    free(child->fds);
+    bitmap_destroy(child->fd_map);
+    child->fds = NULL;
+    child->fd_map = NULL;
+    return false;
+  }
+  child->fd_cnt = parent->fd_cnt;
+
+  lock_acquire(&file_lock);
+  for(i = 0; i < child->fd_cnt; i++) {
+    child->fds[i] = parent->fds[i];
+    bitmap_set(child->fd_map, i, bitmap_test(parent->fd_map, i));
+    if(child->fds[i] != NULL)
+      child->fds[i]->ref_cnt++;
   }
-  return NULL;
+  lock_release(&file_lock);
+  return true;
+}
+
+
+/* Closes every fd in T's fd table and frees the table.  A
+   process killed in the middle of a system call may still hold
+   file_lock, which is released here either way. */
+void
+fd_table_destroy (struct thread *t)
+{
+  size_t i;
+
+  if(!lock_held_by_current_thread(&file_lock))
+    lock_acquire(&file_lock);
+  for(i = 0; i < t->fd_cnt; i++)
+    if(t->fds[i] != NULL)
+      release_open_file(t->fds[i]);
+  lock_release(&file_lock);
+
+  free(t->fds);
+  bitmap_destroy(t->fd_map);
+  t->fds = NULL;
+  t->fd_map = NULL;
+  t->fd_cnt = 0;
 }
 
-/*finds the first file in the current threads file_list with the given fd
-and closes it.
+
+/* Returns the open file with the given fd in T's fd table, or
+   null if there is none. */
+struct open_file *
+get_open_file_by_fd(struct thread *t, int descriptor)
+{
+  if(descriptor < 0 || (size_t) descriptor >= t->fd_cnt)
+    return NULL;
+  return t->fds[descriptor];
+}
+
+/*finds the file in the current thread's fd table with the given fd,
+drops it, and frees its slot for reuse.  Closing 0 or 1 after
+dup2() sends them back to the console.
 */
 void
 close (int fd)
@@ -347,9 +720,12 @@ close (int fd)
   struct thread *cur = thread_current();
   struct open_file *of = get_open_file_by_fd(cur, fd);
   if(of != NULL) {
-    file_close(of->file);
-    list_remove(&of->elem);
-    free(of);
+    lock_acquire(&file_lock);
+    cur->fds[fd] = NULL;
+    if(fd > STDOUT_FILENO)
+      bitmap_reset(cur->fd_map, fd);
+    release_open_file(of);
+    lock_release(&file_lock);
   }
   else
     exit(-1);
@@ -361,28 +737,29 @@ int
 write (int fd, const void *buffer, unsigned size)
 {
   int ret_stat = -1;
-  if (fd == STDIN_FILENO)
-    ret_stat = -1;
-  /* Write to a buffer. */
-  else if (fd == STDOUT_FILENO)
+  struct open_file *of = get_open_file_by_fd(thread_current(), fd);
+  if (of == NULL)
   {
-    lock_acquire(&file_lock);
-    putbuf (buffer, size);
-    lock_release(&file_lock);
-    ret_stat = size;
-  }
-  /* Write to a file. */
-  else {
-    struct thread *t = thread_current();
-    struct open_file *of = get_open_file_by_fd(t, fd);
-    
-    if (of != NULL) {
+    /* Write to a buffer. */
+    if (fd == STDOUT_FILENO)
+    {
       lock_acquire(&file_lock);
-      ret_stat = file_write (of->file, buffer, size);
+      putbuf (buffer, size);
       lock_release(&file_lock);
+      ret_stat = size;
     }
-    else
-      ret_stat = -1;
+  }
+  /* Write to a pipe, without file_lock since it may block. */
+  else if (of->pipe != NULL)
+  {
+    if (of->writer)
+      ret_stat = pipe_write (of->pipe, buffer, size);
+  }
+  /* Write to a file. */
+  else {
+    lock_acquire(&file_lock);
+    ret_stat = file_write (of->file, buffer, size);
+    lock_release(&file_lock);
   }
   return ret_stat;
 }
@@ -393,29 +770,33 @@ int
 read (int fd, void * buffer, unsigned size)
 {
   int ret_stat = -1;
-  struct thread *t = thread_current();
   unsigned int i = 0;
   uint8_t* new_buffer = (uint8_t *) buffer;
-  if (fd == STDOUT_FILENO)
-    ret_stat = -1;
-  /* Read a buffer. */
-  else if (fd == STDIN_FILENO)
+  struct open_file *of = get_open_file_by_fd(thread_current(), fd);
+  if (of == NULL)
   {
-    lock_acquire(&file_lock);
-    for (; i < size; i++) {
-      new_buffer[i] = input_getc();
+    /* Read a buffer. */
+    if (fd == STDIN_FILENO)
+    {
+      lock_acquire(&file_lock);
+      for (; i < size; i++) {
+        new_buffer[i] = input_getc();
+      }
+      lock_release(&file_lock);
+      ret_stat = size;
     }
-    lock_release(&file_lock);
-    return size;
+  }
+  /* Read a pipe, without file_lock since it may block. */
+  else if (of->pipe != NULL)
+  {
+    if (!of->writer)
+      ret_stat = pipe_read (of->pipe, buffer, size);
   }
   /* Read a file. */
   else {
-    struct open_file *of = get_open_file_by_fd (t, fd);
-    if (of != NULL) {
-      lock_acquire(&file_lock);
-      ret_stat = file_read (of->file, buffer, size);
-      lock_release(&file_lock);
-    }
+    lock_acquire(&file_lock);
+    ret_stat = file_read (of->file, buffer, size);
+    lock_release(&file_lock);
   }
   return ret_stat;
 }
@@ -427,7 +808,7 @@ seek (int file_desc, unsigned position)
 {
   struct thread *t = thread_current();
   struct open_file *of = get_open_file_by_fd (t, file_desc);
-  if (of != NULL) {
+  if (of != NULL && of->file != NULL) {
     lock_acquire(&file_lock);
     file_seek (of->file, position);
     lock_release(&file_lock);
@@ -442,7 +823,7 @@ tell(int fd)
   off_t ret_stat = 0;
   struct thread *t = thread_current();
   struct open_file *of = get_open_file_by_fd (t, fd);
-  if (of != NULL){
+  if (of != NULL && of->file != NULL){
     lock_acquire(&file_lock);
     ret_stat = file_tell (of->file);
     lock_release(&file_lock);
@@ -458,13 +839,173 @@ filesize(int fd)
   int ret_stat = 0;
   struct thread *t = thread_current();
   struct open_file *of = get_open_file_by_fd (t, fd);
-  if (of != NULL) {
+  if (of != NULL && of->file != NULL) {
     ret_stat = file_length (of->file);
   }
   return ret_stat;
 }
 
 
+/* Syscall readv.  Reads into each of the IOVCNT buffers in IOV
+   in turn, as read() would, stopping early at end of file.  The
+   file lock is held throughout, so no other read or write lands
+   between the buffers. */
+int
+readv (int fd, const struct iovec *iov, int iovcnt)
+{
+  struct open_file *of = get_open_file_by_fd(thread_current(), fd);
+  int total = 0;
+  int i;
+
+  if(of == NULL && fd != STDIN_FILENO)
+    return -1;
+  if(of != NULL && of->pipe != NULL) {
+    /* Pipes block, so go a buffer at a time without file_lock,
+       stopping once the pipe runs dry. */
+    if(of->writer)
+      return -1;
+    for(i = 0; i < iovcnt; i++) {
+      int n = pipe_read(of->pipe, iov[i].iov_base, iov[i].iov_len);
+      total += n;
+      if((size_t) n < iov[i].iov_len)
+        break;
+    }
+    return total;
+  }
+
+  lock_acquire(&file_lock);
+  for(i = 0; i < iovcnt; i++) {
+    uint8_t *buffer = iov[i].iov_base;
+    size_t size = iov[i].iov_len;
+    size_t j;
+
+    if(of == NULL) {
+      for(j = 0; j < size; j++)
+        buffer[j] = input_getc();
+      total += size;
+    }
+    else {
+      off_t n = file_read(of->file, buffer, size);
+      total += n;
+      if((size_t) n < size)
+        break;
+    }
+  }
+  lock_release(&file_lock);
+  return total;
+}
+
+
+/* Syscall writev.  Writes each of the IOVCNT buffers in IOV in
+   turn, as write() would, with the file lock held throughout.
+   Stops early if the file cannot grow. */
+int
+writev (int fd, const struct iovec *iov, int iovcnt)
+{
+  struct open_file *of = get_open_file_by_fd(thread_current(), fd);
+  int total = 0;
+  int i;
+
+  if(of == NULL && fd != STDOUT_FILENO)
+    return -1;
+  if(of != NULL && of->pipe != NULL) {
+    /* Pipes block, so go a buffer at a time without file_lock. */
+    if(!of->writer)
+      return -1;
+    for(i = 0; i < iovcnt; i++) {
+      if(pipe_write(of->pipe, iov[i].iov_base, iov[i].iov_len) < 0)
+        return total > 0 ? total : -1;
+      total += iov[i].iov_len;
+    }
+    return total;
+  }
+
+  lock_acquire(&file_lock);
+  for(i = 0; i < iovcnt; i++) {
+    const void *buffer = iov[i].iov_base;
+    size_t size = iov[i].iov_len;
+
+    if(of == NULL) {
+      putbuf(buffer, size);
+      total += size;
+    }
+    else {
+      off_t n = file_write(of->file, buffer, size);
+      total += n;
+      if((size_t) n < size)
+        break;
+    }
+  }
+  lock_release(&file_lock);
+  return total;
+}
+
+
+/* Syscall pread.  Reads SIZE bytes from fd at byte OFFSET into
+   BUFFER without using or changing the file position, so
+   readers sharing a file need not seek first. */
+int
+pread (int fd, void *buffer, unsigned size, unsigned offset)
+{
+  struct open_file *of = get_open_file_by_fd(thread_current(), fd);
+  int ret_stat;
+
+  if(of == NULL || of->file == NULL || (off_t) offset < 0)
+    return -1;
+  lock_acquire(&file_lock);
+  ret_stat = file_read_at(of->file, buffer, size, offset);
+  lock_release(&file_lock);
+  return ret_stat;
+}
+
+
+/* Syscall pwrite.  Writes SIZE bytes from BUFFER to fd at byte
+   OFFSET without using or changing the file position. */
+int
+pwrite (int fd, const void *buffer, unsigned size, unsigned offset)
+{
+  struct open_file *of = get_open_file_by_fd(thread_current(), fd);
+  int ret_stat;
+
+  if(of == NULL || of->file == NULL || (off_t) offset < 0)
+    return -1;
+  lock_acquire(&file_lock);
+  ret_stat = file_write_at(of->file, buffer, size, offset);
+  lock_release(&file_lock);
+  return ret_stat;
+}
+
+
+/* Syscall copy_file_range.  Copies SIZE bytes from fd IN_FD at
+   byte IN_OFFSET to fd OUT_FD at byte OUT_OFFSET entirely in the
+   kernel, so the data is neither copied through user memory nor
+   validated byte by byte.  Neither file position is used or
+   changed.  Returns the number of bytes copied, which is short
+   at end of either file, or -1 if an fd is bad or the two ranges
+   overlap within one file. */
+int
+copy_file_range (int in_fd, unsigned in_offset,
+                 int out_fd, unsigned out_offset, unsigned size)
+{
+  struct thread *t = thread_current();
+  struct open_file *in = get_open_file_by_fd(t, in_fd);
+  struct open_file *out = get_open_file_by_fd(t, out_fd);
+  int ret_stat;
+
+  if(in == NULL || out == NULL || in->file == NULL || out->file == NULL
+     || (off_t) in_offset < 0 || (off_t) out_offset < 0 || (off_t) size < 0)
+    return -1;
+  if(file_get_inode(in->file) == file_get_inode(out->file)
+     && in_offset < out_offset + size && out_offset < in_offset + size)
+    return -1;
+
+  lock_acquire(&file_lock);
+  ret_stat = file_copy_at(in->file, in_offset, out->file, out_offset, size);
+  lock_release(&file_lock);
+  return ret_stat;
+}
+
+
 /* Check if the user_ptr is a valid user virtual address or not. */
 bool
 is_valid_ptr(const void *user_ptr, struct intr_frame *f)
@@ -494,6 +1035,8 @@ mmap(int fd, void *addr)
 {
   struct thread *t = thread_current();
   struct open_file *of = get_open_file_by_fd (t, fd);
+  if(of == NULL || of->file == NULL)
+    return -1;
   struct file *f = of->file;
 
   if(addr == NULL || !is_user_vaddr(addr)
@@ -530,6 +1073,80 @@ mmap(int fd, void *addr)
 }
 
 
+/* Map SIZE bytes of zeroed memory at ADDR, rounded up to whole
+   pages.  Pages are only given frames when first touched.
+   Unmapped with munmap() like a file mapping. */
+int
+mmap_anon(void *addr, unsigned size)
+{
+  struct thread *t = thread_current();
+  uint8_t *upage = addr;
+  uint8_t *stack_bottom = (uint8_t *) PHYS_BASE - STACK_MAX;
+  size_t page_cnt;
+
+  // the mapping must lie between the code segment and the stack.
+  // Check SIZE before rounding it up, which could overflow.
+  if(addr == NULL || size == 0
+     || addr < ((void *) 0x08048000)
+     || pg_ofs(addr) != 0
+     || upage >= stack_bottom
+     || size > (size_t) (stack_bottom - upage))
+    return -1;
+  page_cnt = DIV_ROUND_UP(size, PGSIZE);
+
+  t->mapid++;
+  for(; page_cnt > 0; page_cnt--, upage += PGSIZE) {
+    if(!create_mmap_page_table(NULL, 0, upage, 0, PGSIZE)) {
+      munmap(t->mapid);
+      return -1;
+    }
+  }
+
+  return t->mapid;
+}
+
+
+/* Move the end of the heap by INCREMENT bytes and return its old
+   end, or (void *) -1 if the heap would run into the stack area
+   or an existing mapping.  New pages are zeroed on first touch;
+   pages wholly above the new end are released. */
+void *
+sbrk(intptr_t increment)
+{
+  struct thread *t = thread_current();
+  uint8_t *old_brk = t->heap_brk;
+  uint8_t *new_brk = old_brk + increment;
+  uint8_t *upage;
+
+  // check for wraparound as well as the limits
+  if(increment > 0
+     && (new_brk < old_brk || new_brk > (uint8_t *) PHYS_BASE - STACK_MAX))
+    return (void *) -1;
+  if(increment < 0 && (new_brk > old_brk || new_brk < t->heap_start))
+    return (void *) -1;
+
+  if(increment > 0) {
+    for(upage = pg_round_up(old_brk); upage < new_brk; upage += PGSIZE) {
+      if(!create_page_table(NULL, 0, upage, 0, PGSIZE, true)) {
+        // Ran into a mapping: undo the pages added so far.
+        while(upage > (uint8_t *) pg_round_up(old_brk)) {
+          upage -= PGSIZE;
+          spt_destroy_page(get_spte(upage));
+        }
+        return (void *) -1;
+      }
+    }
+  }
+  else {
+    for(upage = pg_round_up(new_brk); upage < old_brk; upage += PGSIZE)
+      spt_destroy_page(get_spte(upage));
+  }
+
+  t->heap_brk = new_brk;
+  return old_brk;
+}
+
+
 void
 munmap(int mapping)
 {
@@ -548,22 +1165,22 @@ munmap(int mapping)
     // or mapping is 0, which is called in process_exit(), unmap all the pages
     if(mme->mapid == mapping || mapping == 0) {
       spte->pinned = true;
+      if(spte->locked)
+        frame_unlock_page(spte);
       if(spte->loaded) {
-        if(pagedir_is_dirty(t->pagedir, spte->upage)) {
-	  lock_acquire(&file_lock);
-	  //write back to the file
-          file_write_at(spte->file, spte->upage, spte->read_bytes, spte->ofs);
-	  lock_release(&file_lock);
-        }
+        writeback_page(spte);
 	
 	// free frame and clear page
         free_frame(spte->frame);
         pagedir_clear_page(t->pagedir, spte->upage);
 	
       }
+      // anonymous pages may have been swapped out
+      else if(spte->swap)
+        swap_free(spte->swap_sector);
       
       list_remove(&mme->elem);
-      hash_delete(&t->spt, &spte->elem);
+      spt_remove(spte);
       
       if(mme->mapid != current_id) {
 	if(f) {
@@ -589,4 +1206,325 @@ munmap(int mapping)
 }
 
 
+/* Return true if every page in the LENGTH bytes at ADDR, which
+   must be page-aligned, is in the supplemental page table. */
+static bool
+range_mapped(void *addr, unsigned length)
+{
+  uint8_t *upage;
+
+  if(pg_ofs(addr) != 0 || !is_user_vaddr(addr)
+     || length > (size_t) ((uint8_t *) PHYS_BASE - (uint8_t *) addr))
+    return false;
+  for(upage = addr; upage < (uint8_t *) addr + length; upage += PGSIZE)
+    if(!get_spte(upage))
+      return false;
+  return true;
+}
+
+
+/* If SPTE is a loaded page of a mapped file and has been written
+   since it was loaded or last written back, write it back and
+   mark it clean.  The caller must pin SPTE. */
+static void
+writeback_page(struct spt_entry *spte)
+{
+  struct thread *t = thread_current();
+
+  if(!spte->mmap || !spte->loaded
+     || !pagedir_is_dirty(t->pagedir, spte->upage))
+    return;
+
+  lock_acquire(&file_lock);
+  file_write_at(spte->file, spte->frame, spte->read_bytes, spte->ofs);
+  lock_release(&file_lock);
+  pagedir_set_dirty(t->pagedir, spte->upage, false);
+}
+
+
+/* Drop SPTE's contents, so the next access reloads it: a mapped
+   file page from its file after writing it back, a program page
+   from the executable, and anonymous memory as zeros.  Shared
+   memory and locked pages are left alone. */
+static void
+discard_page(struct spt_entry *spte)
+{
+  struct thread *t = thread_current();
+
+  if(spte->shm || spte->locked)
+    return;
+
+  spte->pinned = true;
+  if(spte->loaded) {
+    writeback_page(spte);
+    pagedir_clear_page(t->pagedir, spte->upage);
+    free_frame(spte->frame);
+    spte->loaded = false;
+  }
+  else if(spte->swap)
+    swap_free(spte->swap_sector);
+  spte->swap = false;
+  spte->pinned = false;
+}
+
+
+/* Write the dirty pages of mapped files in the LENGTH bytes at
+   ADDR back to their files.  Clean pages cost nothing, so this
+   can be called often to flush a mapping bit by bit.  Returns
+   false if ADDR is not page-aligned or the range is not all
+   mapped. */
+bool
+msync(void *addr, unsigned length)
+{
+  uint8_t *upage;
+
+  if(!range_mapped(addr, length))
+    return false;
+
+  for(upage = addr; upage < (uint8_t *) addr + length; upage += PGSIZE) {
+    struct spt_entry *spte = get_spte(upage);
+    spte->pinned = true;
+    writeback_page(spte);
+    spte->pinned = false;
+  }
+  return true;
+}
+
+
+/* Apply ADVICE, one of enum page_advice, to the pages in the
+   LENGTH bytes at ADDR.  NORMAL, RANDOM, and SEQUENTIAL set the
+   read-ahead behavior for later faults, WILLNEED reads file
+   pages into free frames now, and DONTNEED drops the pages as
+   discard_page() describes.  Returns false if ADDR is not
+   page-aligned, the range is not all mapped, or ADVICE is
+   unknown. */
+bool
+madvise(void *addr, unsigned length, int advice)
+{
+  uint8_t *upage;
+
+  if(advice < ADVICE_NORMAL || advice > ADVICE_DONTNEED
+     || !range_mapped(addr, length))
+    return false;
+
+  for(upage = addr; upage < (uint8_t *) addr + length; upage += PGSIZE) {
+    struct spt_entry *spte = get_spte(upage);
+    switch(advice) {
+      case ADVICE_NORMAL:
+      case ADVICE_RANDOM:
+      case ADVICE_SEQUENTIAL:
+        spte->advice = advice;
+        break;
+      case ADVICE_WILLNEED:
+        // out of free frames: the rest will fault in as usual
+        if(!page_prefetch(spte))
+          return true;
+        break;
+      case ADVICE_DONTNEED:
+        discard_page(spte);
+        break;
+    }
+  }
+  return true;
+}
+
+
+/* Bring every page that overlaps the LENGTH bytes at ADDR into
+   memory and keep it there until munlock() or exit, so touching
+   it never faults.  Fails, locking nothing new, if part of the
+   range is not mapped or is shared memory, or if the process
+   would then have more than MLOCK_LIMIT pages locked or the
+   system as a whole more than its share of the user pool. */
+bool
+mlock(const void *addr, unsigned length)
+{
+  struct thread *t = thread_current();
+  uint8_t *start = pg_round_down(addr);
+  size_t new_cnt = 0;
+  uint8_t *upage;
+
+  if(length == 0)
+    return true;
+  if(!range_mapped(start, (uint8_t *) addr + length - start))
+    return false;
+
+  for(upage = start; upage < (uint8_t *) addr + length; upage += PGSIZE) {
+    struct spt_entry *spte = get_spte(upage);
+    if(spte->shm)
+      return false;
+    if(!spte->locked)
+      new_cnt++;
+  }
+  if(t->locked_cnt + new_cnt > MLOCK_LIMIT
+     || !frame_reserve_locked(new_cnt))
+    return false;
+
+  // Fault everything in first, pinned, so a failure leaves no
+  // new locks behind.
+  for(upage = start; upage < (uint8_t *) addr + length; upage += PGSIZE) {
+    struct spt_entry *spte = get_spte(upage);
+    if(spte->locked)
+      continue;
+    spte->pinned = true;
+    if(!load_page(spte)) {
+      for(; upage >= start; upage -= PGSIZE)
+        get_spte(upage)->pinned = false;
+      frame_unreserve_locked(new_cnt);
+      return false;
+    }
+  }
+
+  for(upage = start; upage < (uint8_t *) addr + length; upage += PGSIZE) {
+    struct spt_entry *spte = get_spte(upage);
+    if(!spte->locked)
+      frame_lock_page(spte);
+    spte->pinned = false;
+  }
+  return true;
+}
+
+
+/* Let the pages that overlap the LENGTH bytes at ADDR be evicted
+   again.  Pages that are not locked are skipped.  Returns false
+   if part of the range is not mapped. */
+bool
+munlock(const void *addr, unsigned length)
+{
+  uint8_t *start = pg_round_down(addr);
+  uint8_t *upage;
+
+  if(length == 0)
+    return true;
+  if(!range_mapped(start, (uint8_t *) addr + length - start))
+    return false;
+
+  for(upage = start; upage < (uint8_t *) addr + length; upage += PGSIZE) {
+    struct spt_entry *spte = get_spte(upage);
+    if(spte->locked)
+      frame_unlock_page(spte);
+  }
+  return true;
+}
+
+
+/* Make the unmapped page at ADDR the process's I/O ring, laid out
+   as struct io_ring in lib/io-ring.h.  It is an ordinary zeroed
+   anonymous page, which the kernel reads and writes through its
+   frame while it is pinned in ring_enter().  A process has at
+   most one ring, which goes away when it exits. */
+bool
+ring_setup(void *addr)
+{
+  struct thread *t = thread_current();
+
+  if(t->ring != NULL || addr == NULL || !is_user_vaddr(addr)
+     || addr < ((void *) 0x08048000) || pg_ofs(addr) != 0)
+    return false;
+  if(!create_page_table(NULL, 0, addr, 0, PGSIZE, true))
+    return false;
+
+  t->ring = addr;
+  return true;
+}
+
+
+/* Carry out up to TO_SUBMIT requests from the I/O ring, oldest
+   first, posting a completion for each.  Stops early if the
+   completion queue fills up.  Returns the number of requests
+   consumed, or -1 if the process has no ring or its indexes are
+   inconsistent.
+
+   The whole batch costs one trap.  Each request is validated
+   and carried out exactly like the system call it names, so a
+   bad pointer still kills the process.  The file system does
+   all I/O synchronously, so every request consumed has also
+   completed when this returns. */
+int
+ring_enter(unsigned to_submit, struct intr_frame *f)
+{
+  struct thread *t = thread_current();
+  struct spt_entry *spte;
+  struct io_ring *r;
+  unsigned done = 0;
 
+  if(t->ring == NULL || (spte = get_spte(t->ring)) == NULL)
+    return -1;
+  spte->pinned = true;
+  if(!load_page(spte)) {
+    spte->pinned = false;
+    return -1;
+  }
+  r = (struct io_ring *) spte->frame;
+
+  if(r->sq_tail - r->sq_head > IO_RING_SQ_ENTRIES
+     || r->cq_tail - r->cq_head > IO_RING_CQ_ENTRIES) {
+    spte->pinned = false;
+    return -1;
+  }
+
+  while(done < to_submit && r->sq_head != r->sq_tail
+        && r->cq_tail - r->cq_head < IO_RING_CQ_ENTRIES) {
+    // copy the request so the process cannot change it under us
+    struct io_ring_sqe sqe = r->sq[r->sq_head & IO_RING_SQ_MASK];
+    struct io_ring_cqe *cqe = &r->cq[r->cq_tail & IO_RING_CQ_MASK];
+
+    cqe->user_data = sqe.user_data;
+    cqe->res = ring_execute(&sqe, f);
+    r->sq_head++;
+    r->cq_tail++;
+    done++;
+  }
+
+  // The process's mapping did not see these writes, so make sure
+  // the page is swapped out rather than dropped if evicted.
+  pagedir_set_dirty(t->pagedir, t->ring, true);
+  spte->pinned = false;
+  return done;
+}
+
+
+/* Carry out SQE and return what the matching system call would.
+   Buffers may not overlap the ring: validating them could unpin
+   the ring page while the kernel is using its frame. */
+static int
+ring_execute(const struct io_ring_sqe *sqe, struct intr_frame *f)
+{
+  uintptr_t ring = (uintptr_t) thread_current()->ring;
+  void *buffer = (void *) sqe->addr;
+
+  switch(sqe->op) {
+    case IO_RING_NOP:
+      return 0;
+    case IO_RING_OPEN:
+      return open(buffer);
+    case IO_RING_CLOSE:
+      close(sqe->fd);
+      return 0;
+    case IO_RING_SEEK:
+      seek(sqe->fd, sqe->offset);
+      return 0;
+    case IO_RING_READ:
+    case IO_RING_WRITE:
+    case IO_RING_PREAD:
+    case IO_RING_PWRITE:
+      break;
+    default:
+      return -1;
+  }
+
+  if(sqe->addr < ring + PGSIZE && sqe->addr + sqe->len > ring)
+    return -1;
+  check_buffer(buffer, sqe->len, f);
+  switch(sqe->op) {
+    case IO_RING_READ:
+      check_writable(buffer, sqe->len, f);
+      return read(sqe->fd, buffer, sqe->len);
+    case IO_RING_PREAD:
+      check_writable(buffer, sqe->len, f);
+      return pread(sqe->fd, buffer, sqe->len, sqe->offset);
+    case IO_RING_WRITE:
+      return write(sqe->fd, buffer, sqe->len);
+    default:
+      return pwrite(sqe->fd, buffer, sqe->len, sqe->offset);
+  }
+}
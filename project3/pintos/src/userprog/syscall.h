@@ -5,6 +5,10 @@
 
 void syscall_init (void);
 void exit (int);
+
+struct thread;
+bool fd_table_inherit (struct thread *child, struct thread *parent);
+void fd_table_destroy (struct thread *);
 //bool is_valid_ptr(const void *user_ptr, struct intr_frame *f);
 //bool is_valid_ptr(const void *, struct intr_frame *);
 
@@ -0,0 +1,129 @@
+#include "userprog/sysenter.h"
+#include <stdint.h>
+#include "threads/flags.h"
+#include "threads/interrupt.h"
+#include "threads/loader.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Fast system call entry.
+
+   "int $0x30" goes through the IDT, checks the gate's privilege,
+   loads the kernel stack from the TSS, and pushes five words;
+   "iret" undoes all of that and checks it again on the way out.
+   "sysenter" and "sysexit" skip nearly all of it: they load
+   flat code and stack segments and an entry point that the
+   kernel puts in model-specific registers (MSRs) ahead of time.
+
+   The price is that the processor saves nothing.  The caller
+   passes its stack pointer in %ecx and its return address in
+   %edx, and "sysexit" returns to those.  syscall_sysenter in
+   lib/user/syscall.c follows this convention, and
+   sysenter_entry in userprog/sysenter-entry.S turns the entry
+   into a `struct intr_frame' just like the one the "int $0x30"
+   path builds, so system calls are handled by the same code
+   either way.
+
+   "sysenter" also does not consult the TSS, so it cannot find
+   the running thread's kernel stack by itself.  Instead,
+   sysenter_update() stores it in an MSR on every thread switch,
+   alongside tss_update().
+
+   Finally, "sysenter" leaves the trap flag alone, so a process
+   that single-steps into it takes a debug exception on the
+   kernel's first instruction.  sysenter_debug() clears the flag
+   there and tells sysenter_entry to put it back into the saved
+   user flags, and sysenter_entry then returns with "iret",
+   which restores them. */
+
+/* Model-specific registers.  See [IA32-v3a] 5.8.7. */
+#define MSR_SYSENTER_CS  0x174  /* Kernel code selector. */
+#define MSR_SYSENTER_ESP 0x175  /* Kernel stack pointer. */
+#define MSR_SYSENTER_EIP 0x176  /* Kernel entry point. */
+
+/* CPUID feature bit for sysenter and sysexit. */
+#define CPUID_SEP (1u << 11)
+
+bool sysenter_enabled;
+
+/* Set by sysenter_debug() to tell sysenter_entry that the
+   process had the trap flag set.  Cleared by sysenter_entry. */
+bool sysenter_single_step;
+
+/* Bounds of the part of sysenter_entry that runs before it
+   clears the flags.  See sysenter-entry.S. */
+void sysenter_entry (void);
+void sysenter_entry_flags_clear (void);
+
+/* Writes VALUE to model-specific register MSR. */
+static inline void
+wrmsr (uint32_t msr, uint32_t value)
+{
+  /* See [IA32-v2b] "WRMSR". */
+  asm volatile ("wrmsr" : : "c" (msr), "a" (value), "d" (0));
+}
+
+/* Returns true if the processor implements sysenter and
+   sysexit. */
+static bool
+sysenter_supported (void)
+{
+  uint32_t eax, ebx, ecx, edx;
+  unsigned family, model, stepping;
+
+  /* See [IA32-v2a] "CPUID". */
+  asm ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (1));
+  if (!(edx & CPUID_SEP))
+    return false;
+
+  /* The earliest Pentium Pro models set the bit but do not
+     implement the instructions. */
+  family = (eax >> 8) & 0xf;
+  model = (eax >> 4) & 0xf;
+  stepping = eax & 0xf;
+  return !(family == 6 && model < 3 && stepping < 3);
+}
+
+/* Sets up the processor for "sysenter", if it supports it.
+   "sysexit" derives the user code and stack selectors from the
+   kernel code selector, which the GDT is laid out to match. */
+void
+sysenter_init (void)
+{
+  if (!sysenter_supported ())
+    return;
+
+  wrmsr (MSR_SYSENTER_CS, SEL_KCSEG);
+  wrmsr (MSR_SYSENTER_EIP, (uint32_t) sysenter_entry);
+  sysenter_enabled = true;
+  sysenter_update ();
+}
+
+/* Points "sysenter" at the end of the running thread's kernel
+   stack. */
+void
+sysenter_update (void)
+{
+  if (sysenter_enabled)
+    wrmsr (MSR_SYSENTER_ESP, (uint32_t) thread_current () + PGSIZE);
+}
+
+/* Handles debug exception F if it was raised on entry to the
+   kernel with "sysenter" while the process had the trap flag
+   set: clears the flag so that sysenter_entry can go on, and
+   arranges for it to be restored on return to the process.
+   Returns true if F was handled this way, false otherwise. */
+bool
+sysenter_debug (struct intr_frame *f)
+{
+  uintptr_t eip = (uintptr_t) f->eip;
+
+  if (f->cs != SEL_KCSEG
+      || eip < (uintptr_t) sysenter_entry
+      || eip >= (uintptr_t) sysenter_entry_flags_clear)
+    return false;
+
+  f->eflags &= ~FLAG_TF;
+  sysenter_single_step = true;
+  return true;
+}
@@ -0,0 +1,16 @@
+#ifndef USERPROG_SYSENTER_H
+#define USERPROG_SYSENTER_H
+
+#include <stdbool.h>
+
+struct intr_frame;
+
+/* True if user processes may enter system calls with
+   "sysenter", false if they must use "int $0x30". */
+extern bool sysenter_enabled;
+
+void sysenter_init (void);
+void sysenter_update (void);
+bool sysenter_debug (struct intr_frame *);
+
+#endif /* userprog/sysenter.h */
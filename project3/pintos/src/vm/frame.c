@@ -1,4 +1,6 @@
+#include <debug.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <list.h>
 #include "threads/malloc.h"
 #include "threads/palloc.h"
@@ -6,32 +8,64 @@
 #include "userprog/pagedir.h"
 #include "vm/frame.h"
 #include "vm/page.h"
+#include "vm/shm.h"
 #include "vm/swap.h"
 
 uint8_t *frame_evict(enum palloc_flags flag);
+static void add_frame(uint8_t *frame, struct spt_entry *spte,
+                      struct shm_page *shm);
 
+// Statistics, protected by frame_lock.
+static unsigned long long evict_cnt;    // frames evicted
+static unsigned long long locked_skips; // locked frames passed over
+static size_t locked_cnt;               // pages locked by mlock()
+static size_t locked_peak;              // most pages locked at once
 
-/* Set a frame to a supplemental page. */
+
+/* Set a frame to a supplemental page.  Returns a null pointer
+   if no frame is free and none can be evicted. */
 uint8_t *
 palloc_get_frame(enum palloc_flags flag, struct spt_entry *spte)
 {
   uint8_t *frame = palloc_get_page (flag);
 
-  // Get a free frame, connect it with a supplemental page
-  // add it to the frame table
-  if(frame) {
+  // No free frame now, evict one to get a free frame
+  if(!frame)
+    frame = frame_evict(flag);
+
+  // connect it with a supplemental page, add it to the frame table
+  if(frame)
     add_to_frame_table(frame, spte);
-  }
-  else {
-    // No free frame now, evict one to get a free frame
-    if(!frame){
-      frame = frame_evict(flag);
-    }
-    if(!frame) {
-      PANIC("No free frame.");
-    }
+
+  return frame;
+}
+
+
+/* Like palloc_get_frame(), but returns a null pointer instead
+   of evicting a frame if none is free. */
+uint8_t *
+palloc_get_free_frame(enum palloc_flags flag, struct spt_entry *spte)
+{
+  uint8_t *frame = palloc_get_page (flag);
+
+  if(frame)
     add_to_frame_table(frame, spte);
-  }
+  return frame;
+}
+
+
+/* Get a frame for shared page SHM.  The frame is not tied to
+   any one process's page.  Returns a null pointer if no frame
+   is free and none can be evicted. */
+uint8_t *
+palloc_get_shared_frame(enum palloc_flags flag, struct shm_page *shm)
+{
+  uint8_t *frame = palloc_get_page (flag);
+
+  if(!frame)
+    frame = frame_evict(flag);
+  if(frame)
+    add_frame(frame, NULL, shm);
 
   return frame;
 }
@@ -40,15 +74,26 @@ palloc_get_frame(enum palloc_flags flag, struct spt_entry *spte)
 /* Set a frame and add it to the frame table. */
 void
 add_to_frame_table(uint8_t *frame, struct spt_entry *spte)
+{
+  add_frame(frame, spte, NULL);
+}
+
+
+/* Add FRAME to the frame table as the frame of SPTE or of shared
+   page SHM, whichever is not null. */
+static void
+add_frame(uint8_t *frame, struct spt_entry *spte, struct shm_page *shm)
 {
   struct frame_entry *fe = malloc(sizeof(struct frame_entry));
 
   // record frame address and the user page
   fe->frame = frame;
   fe->spte = spte;
+  fe->shm = shm;
   fe->owner = thread_current();
 
-  spte->frame = frame;
+  if(spte)
+    spte->frame = frame;
   
   lock_acquire(&frame_lock);
   list_push_back(&frame_table, &fe->elem);
@@ -78,19 +123,109 @@ free_frame(uint8_t *frame)
 }
 
 
-/* Evict a frame. */
+/* Reserve CNT pages of the system-wide limit on locked pages,
+   1/MLOCK_POOL_SHARE of the user pool, for pages about to be
+   locked with frame_lock_page().  Returns false, reserving
+   nothing, if that would go over the limit. */
+bool
+frame_reserve_locked(size_t cnt)
+{
+  size_t limit = palloc_user_page_cnt() / MLOCK_POOL_SHARE;
+  bool success = false;
+
+  lock_acquire(&frame_lock);
+  if(cnt <= limit && locked_cnt <= limit - cnt) {
+    locked_cnt += cnt;
+    if(locked_cnt > locked_peak)
+      locked_peak = locked_cnt;
+    success = true;
+  }
+  lock_release(&frame_lock);
+  return success;
+}
+
+
+/* Return CNT reserved pages that will not be locked after all. */
+void
+frame_unreserve_locked(size_t cnt)
+{
+  lock_acquire(&frame_lock);
+  ASSERT(locked_cnt >= cnt);
+  locked_cnt -= cnt;
+  lock_release(&frame_lock);
+}
+
+
+/* Keep loaded page SPTE of the current process in memory until
+   frame_unlock_page() is called, and count it against the
+   process's mlock() limit.  The page must have been reserved
+   with frame_reserve_locked(). */
+void
+frame_lock_page(struct spt_entry *spte)
+{
+  ASSERT(spte->loaded && !spte->locked);
+
+  lock_acquire(&frame_lock);
+  spte->locked = true;
+  lock_release(&frame_lock);
+  thread_current()->locked_cnt++;
+}
+
+
+/* Let page SPTE of the current process be evicted again. */
+void
+frame_unlock_page(struct spt_entry *spte)
+{
+  ASSERT(spte->locked);
+
+  lock_acquire(&frame_lock);
+  spte->locked = false;
+  locked_cnt--;
+  lock_release(&frame_lock);
+  thread_current()->locked_cnt--;
+}
+
+
+/* Print eviction and page locking statistics. */
+void
+frame_print_stats(void)
+{
+  printf("Frame: %llu evictions, %llu locked frames skipped, "
+         "%zu pages locked (peak %zu)\n",
+         evict_cnt, locked_skips, locked_cnt, locked_peak);
+}
+
+
+/* Evict a frame.  Returns a null pointer if two full passes
+   over the frame table find nothing to evict, which happens
+   only if every frame is locked, pinned, or busy. */
     uint8_t *
 frame_evict(enum palloc_flags flag)
 {
     lock_acquire(&frame_lock);
     struct list_elem *e = list_begin(&frame_table);
+    size_t tries = 2 * list_size(&frame_table);
 
     // check all the frame in frame table
-    while(true){
+    while(tries-- > 0){
         struct frame_entry *fe = list_entry(e, struct frame_entry, elem);
 
         struct thread *t = fe->owner;
-        if(!fe->spte->pinned) {
+        if(fe->shm) {
+            // shared pages are unmapped from every process at once
+            if(shm_evict_frame(fe->shm, fe->frame)) {
+                evict_cnt++;
+                list_remove(&fe->elem);
+                palloc_free_page(fe->frame);
+                free(fe);
+
+                lock_release(&frame_lock);
+                return palloc_get_page(flag);
+            }
+        }
+        else if(fe->spte->locked)
+            locked_skips++;
+        else if(!fe->spte->pinned) {
             if(pagedir_is_accessed(t->pagedir, fe->spte->upage))
             {
                 pagedir_set_accessed(t->pagedir, fe->spte->upage, false);
@@ -107,10 +242,11 @@ frame_evict(enum palloc_flags flag)
                                 fe->spte->ofs);
                     // user pages, swap it out
                     else {
-                        swap_out (fe->spte);
+                        swap_out (fe->spte, fe->frame);
                     }
                 }
                 // free a frame
+                evict_cnt++;
                 fe->spte->loaded = false;
                 list_remove(&fe->elem);
                 pagedir_clear_page(t->pagedir, fe->spte->upage);
@@ -127,5 +263,8 @@ frame_evict(enum palloc_flags flag)
         e = list_next(e);
         if(e == list_end(&frame_table))
             e = list_begin(&frame_table);
-    }  
+    }
+
+    lock_release(&frame_lock);
+    return NULL;
 }
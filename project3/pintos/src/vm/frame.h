@@ -1,6 +1,8 @@
 #ifndef VM_FRAME_H
 #define VM_FRAME_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <list.h>
 
@@ -9,13 +11,21 @@ struct lock frame_lock;
 
 struct frame_entry {
   uint8_t *frame;               // frame address
-  struct spt_entry *spte;       // page entry
+  struct spt_entry *spte;       // page entry, or null if shared
+  struct shm_page *shm;         // shared page, or null if private
   struct thread *owner;         // thread id
   struct list_elem elem;
 };
 
 uint8_t *palloc_get_frame(enum palloc_flags, struct spt_entry *spte);
+uint8_t *palloc_get_free_frame(enum palloc_flags, struct spt_entry *spte);
+uint8_t *palloc_get_shared_frame(enum palloc_flags, struct shm_page *);
 void add_to_frame_table(uint8_t *frame, struct spt_entry *spte);
 void free_frame(uint8_t *frame);
+bool frame_reserve_locked(size_t cnt);
+void frame_unreserve_locked(size_t cnt);
+void frame_lock_page(struct spt_entry *spte);
+void frame_unlock_page(struct spt_entry *spte);
+void frame_print_stats(void);
 
 #endif /* vm/frame.h */
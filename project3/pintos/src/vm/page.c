@@ -1,15 +1,20 @@
 #include "vm/page.h"
 #include <stdbool.h>
 #include <string.h>
+#include <time-page.h>
 #include "threads/malloc.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "threads/palloc.h"
 #include "userprog/pagedir.h"
 #include "userprog/process.h"
+#include "vm/frame.h"
+#include "vm/shm.h"
 #include "vm/swap.h"
 
 bool  load_from_swap(struct spt_entry *spte);
+static bool fill_page(struct spt_entry *spte, uint8_t *kpage);
+static void read_ahead(struct spt_entry *spte);
 
 
 /* Add supplement page to page table.*/
@@ -31,15 +36,21 @@ create_page_table (struct file *file, off_t ofs, uint8_t *upage,
   spte->swap = false;
   spte->mmap = false;
   spte->pinned = false;
+  spte->locked = false;
+  spte->shm = NULL;
+  spte->advice = ADVICE_NORMAL;
 
-  struct thread *t = thread_current();
-
-  // Insert into hash table
-  return (hash_insert(&t->spt, &spte->elem) == NULL);
+  if(!spt_insert(spte)) {
+    free(spte);
+    return false;
+  }
+  return true;
 }
 
 
-/* Add memory mapped files to supplemental page table. */
+/* Add memory mapped files to supplemental page table.
+   A null FILE maps anonymous memory: it is zero-filled on first
+   touch and swapped like any other user page. */
 bool
 create_mmap_page_table(struct file *file, off_t ofs, uint8_t *upage,
 		   uint32_t read_bytes, uint32_t zero_bytes)
@@ -61,15 +72,19 @@ create_mmap_page_table(struct file *file, off_t ofs, uint8_t *upage,
   spte->writable = true;
   spte->loaded = false;
   spte->swap = false;
-  spte->mmap = true;
+  // only file mappings are written back to their file
+  spte->mmap = file != NULL;
   spte->pinned = false;
+  spte->locked = false;
+  spte->shm = NULL;
+  spte->advice = ADVICE_NORMAL;
 
   struct mmap_entry *mme = malloc(sizeof(struct mmap_entry));
   mme->mapid = t->mapid;
   mme->spte = spte;
 
   list_push_back(&t->mmap_list, &mme->elem);
-  return (hash_insert(&t->spt, &spte->elem) == NULL);
+  return spt_insert(spte);
 }
 
 
@@ -94,6 +109,32 @@ get_spte(void *upage)
 }
 
 
+/* Insert SPTE into the current thread's supplemental page table.
+   Returns false if a page is already present at SPTE's address.
+   Only the owning thread uses its table, so it needs no lock. */
+bool
+spt_insert(struct spt_entry *spte)
+{
+  struct thread *t = thread_current();
+
+  // the time page is always there, though not in the table
+  if(spte->upage == TIME_PAGE_ADDR)
+    return false;
+
+  return hash_insert(&t->spt, &spte->elem) == NULL;
+}
+
+
+/* Remove SPTE from the current thread's supplemental page table. */
+void
+spt_remove(struct spt_entry *spte)
+{
+  struct thread *t = thread_current();
+
+  hash_delete(&t->spt, &spte->elem);
+}
+
+
 /* Load page to memory. */
 bool
 load_page(struct spt_entry *spte)
@@ -101,6 +142,10 @@ load_page(struct spt_entry *spte)
    // this page is already in the memory.
    if(spte->loaded)
      return true;
+
+   // shared memory pages are loaded by the segment
+   if(spte->shm)
+     return shm_load_page(spte);
    
    //page is swapped out, load it from swap.
    if(spte->swap){
@@ -116,10 +161,27 @@ load_page(struct spt_entry *spte)
    if (kpage == NULL)
      return false;
 
+   if (!fill_page(spte, kpage))
+     return false;
+
+   // a fault in a mapped file is likely followed by more
+   if(spte->mmap)
+     read_ahead(spte);
+   
+   return true;
+}
+
+
+/* Read SPTE's data from its file into KPAGE, a frame already
+   given to SPTE, and map it.  Frees KPAGE on failure. */
+static bool
+fill_page(struct spt_entry *spte, uint8_t *kpage)
+{
    /* Load this page. */
-   if (file_read_at (spte->file, kpage,
-		     spte->read_bytes, spte->ofs)
-       != (int) spte->read_bytes)
+   if (spte->read_bytes > 0
+       && file_read_at (spte->file, kpage,
+                        spte->read_bytes, spte->ofs)
+          != (int) spte->read_bytes)
    {
      free_frame(kpage);
      return false; 
@@ -134,11 +196,63 @@ load_page(struct spt_entry *spte)
    }
 
    spte->loaded = true;
-   
    return true;
 }
 
 
+/* Load file-backed page SPTE before it is touched, but only into
+   a free frame: speculation never evicts anything.  Returns
+   false if no frame was free or SPTE could not be loaded.
+   Pages already present or not backed by a file are left alone
+   and count as success. */
+bool
+page_prefetch(struct spt_entry *spte)
+{
+   if(spte->loaded || spte->swap || spte->shm || spte->read_bytes == 0)
+     return true;
+
+   spte->pinned = true;
+   uint8_t *kpage = palloc_get_free_frame(PAL_USER, spte);
+   bool ok = kpage != NULL && fill_page(spte, kpage);
+   spte->pinned = false;
+   return ok;
+}
+
+
+/* Read ahead of a fault on mapped file page SPTE, by a window
+   that depends on its madvise() hint.  For a sequential scan,
+   also mark the pages a window behind as unused, so the clock
+   evicts them before anything the process still needs. */
+static void
+read_ahead(struct spt_entry *spte)
+{
+   struct thread *t = thread_current();
+   size_t window, i;
+
+   if(spte->advice == ADVICE_RANDOM)
+     return;
+   window = (spte->advice == ADVICE_SEQUENTIAL
+             ? READAHEAD_SEQUENTIAL : READAHEAD_NORMAL);
+
+   // stop at the end of the mapping or when frames run out
+   for(i = 1; i <= window; i++) {
+     struct spt_entry *next = get_spte(spte->upage + i * PGSIZE);
+     if(!next || next->file != spte->file || !page_prefetch(next))
+       break;
+   }
+
+   if(spte->advice != ADVICE_SEQUENTIAL)
+     return;
+   for(i = window + 1; i <= 2 * window; i++) {
+     struct spt_entry *prev = get_spte(spte->upage - i * PGSIZE);
+     if(!prev || prev->file != spte->file)
+       break;
+     if(prev->loaded)
+       pagedir_set_accessed(t->pagedir, prev->upage, false);
+   }
+}
+
+
 /* Load page from the swap. */
 bool 
 load_from_swap(struct spt_entry *spte)
@@ -155,7 +269,10 @@ load_from_swap(struct spt_entry *spte)
    }
 
    // Call swap_in to load page from swap to memory.
-   swap_in(spte);
+   swap_in(spte, kpage);
+   // swap_in() frees the slot, so the only copy is now in memory:
+   // make sure the next eviction writes it out again.
+   pagedir_set_dirty(thread_current()->pagedir, spte->upage, true);
    return true;
 }
 
@@ -181,19 +298,34 @@ void
 page_action_func(const struct hash_elem *e, void *aux UNUSED)
 {
   struct spt_entry *spte = hash_entry(e, struct spt_entry, elem);
+  if(spte->locked)
+    frame_unlock_page(spte);
   if(spte->loaded) {
     free_frame(spte->frame);
     pagedir_clear_page(thread_current()->pagedir, spte->upage);
   }
+  else if(spte->swap && !spte->shm)
+    swap_free(spte->swap_sector);
   free(spte);
 }
 
 
+/* Remove the page SPTE from the current process: release its
+   frame or swap slot and free SPTE. */
+void
+spt_destroy_page(struct spt_entry *spte)
+{
+  spte->pinned = true;
+  spt_remove(spte);
+  page_action_func(&spte->elem, NULL);
+}
+
+
 /* Stack growth*/
 bool
 grow_stack(void *fault_addr)
 {
-  if((size_t)(PHYS_BASE - pg_round_down(fault_addr)) > (1 << 23))
+  if((size_t)(PHYS_BASE - pg_round_down(fault_addr)) > STACK_MAX)
     return false;
 
   struct spt_entry *spte = malloc(sizeof(struct spt_entry));
@@ -201,16 +333,24 @@ grow_stack(void *fault_addr)
     return false;
   
   spte->upage = pg_round_down(fault_addr);
+  spte->file = NULL;
+  spte->ofs = 0;
+  spte->read_bytes = 0;
+  spte->zero_bytes = PGSIZE;
   spte->writable = true;
   spte->loaded = true;
   spte->swap = true;
+  spte->mmap = false;
   spte->pinned = true;
+  spte->locked = false;
+  spte->shm = NULL;
+  spte->advice = ADVICE_NORMAL;
   
   /* Get a page of memory. */
   uint8_t *frame = palloc_get_frame(PAL_USER, spte);
 
   if(!frame) {
-    free(frame);
+    free(spte);
     return false;
   }
 
@@ -222,10 +362,10 @@ grow_stack(void *fault_addr)
      return false; 
    }
 
-  
+  // no copy exists outside memory; see load_from_swap()
+  pagedir_set_dirty(thread_current()->pagedir, spte->upage, true);
   spte->pinned = false;
   // add it to the supplemental page table
-  struct thread *t = thread_current();
-  return (hash_insert(&t->spt, &spte->elem) == NULL);
+  return spt_insert(spte);
 }
 
@@ -5,6 +5,30 @@
 #include <stdint.h>
 #include "filesys/file.h"
 
+// the stack may grow to this many bytes below PHYS_BASE
+#define STACK_MAX (1 << 23)
+
+// madvise() hints, numbered as MADV_* in lib/user/syscall.h.
+// Only the first three are remembered in a page.
+enum page_advice {
+  ADVICE_NORMAL,        // read ahead a little
+  ADVICE_RANDOM,        // no read-ahead
+  ADVICE_SEQUENTIAL,    // read ahead far, drop pages behind
+  ADVICE_WILLNEED,      // prefetch now
+  ADVICE_DONTNEED       // drop now
+};
+
+// pages one process may lock with mlock()
+#define MLOCK_LIMIT 32
+
+// all processes together may lock 1/MLOCK_POOL_SHARE of the
+// user pool, so eviction always has frames to choose from
+#define MLOCK_POOL_SHARE 4
+
+// pages read ahead of a fault on a mapped file
+#define READAHEAD_NORMAL 4
+#define READAHEAD_SEQUENTIAL 16
+
 struct spt_entry {
   void *upage;
   uint8_t *frame;       // frame entry
@@ -19,6 +43,9 @@ struct spt_entry {
   bool mmap;            // it is a memory mapped file or not
   int mapid;            // if it is a meory mapped file, point out the map id
   bool pinned;          // avoid other process to access when page is using
+  bool locked;          // kept in memory by mlock()
+  struct shm_page *shm; // shared memory page, or null
+  enum page_advice advice; // access pattern hint from madvise()
   
   struct hash_elem elem;
 };
@@ -32,7 +59,11 @@ struct mmap_entry {
 bool create_page_table (struct file *, off_t, uint8_t *,
 			uint32_t, uint32_t, bool);
 struct spt_entry* get_spte(void *);
+bool spt_insert(struct spt_entry *);
+void spt_remove(struct spt_entry *);
+void spt_destroy_page(struct spt_entry *);
 bool load_page(struct spt_entry *);
+bool page_prefetch(struct spt_entry *);
 unsigned page_hash_func(const struct hash_elem *, void *);
 bool page_less_func (const struct hash_elem *, const struct hash_elem *, void *);
 bool grow_stack(void *fault_addr);
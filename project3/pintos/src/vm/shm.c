@@ -0,0 +1,411 @@
+#include "vm/shm.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/swap.h"
+
+/* Shared memory segments.
+
+   A segment is a run of zero-filled pages, named by an integer
+   key, that any number of processes may attach at an address of
+   their choosing.  Each page of a segment is a struct shm_page,
+   and the SPT entry for that page in every attached process
+   points at it, so they all map the same frame.  The frame
+   belongs to the shm_page rather than to any one process.  It
+   is in the frame table with no SPT entry, and when it is
+   evicted it is swapped out once and unmapped from every
+   process that has the segment attached.
+
+   A segment lives until it has been removed with shm_remove()
+   and the last process has detached it.
+
+   shm_lock protects every segment.  frame_evict() holds
+   frame_lock and only tries to acquire shm_lock, skipping
+   shared frames if it cannot, so code here may free frames
+   while holding shm_lock.  It must not allocate them, though:
+   the eviction that an allocation may run would try to acquire
+   shm_lock again. */
+
+/* One page of a segment. */
+struct shm_page {
+  struct shm_segment *seg;      // segment this page is in
+  uint8_t *kpage;               // frame, or null if not in memory
+  size_t swap_slot;             // swap slot, if swapped
+  bool swapped;                 // page is in swap or not
+};
+
+/* A shared memory segment. */
+struct shm_segment {
+  int key;                      // name given to shm_create()
+  size_t page_cnt;              // number of pages
+  struct shm_page *pages;       // page_cnt pages
+  struct list attachments;      // list of shm_attachment
+  bool removed;                 // shm_remove() has been called
+  struct list_elem elem;        // element in segments
+};
+
+/* A segment attached to a process. */
+struct shm_attachment {
+  struct shm_segment *seg;      // attached segment
+  struct thread *t;             // attaching process
+  uint8_t *base;                // user address of the first page
+  struct list_elem seg_elem;    // element in seg->attachments
+  struct list_elem thread_elem; // element in t->shm_list
+};
+
+static struct list segments;    // segments not yet removed
+static struct lock shm_lock;
+
+static void detach(struct shm_attachment *a);
+static void destroy_segment(struct shm_segment *seg);
+
+
+/* Initialize shared memory. */
+void
+shm_init(void)
+{
+  list_init(&segments);
+  lock_init(&shm_lock);
+  lock_profile(&shm_lock, "shm_lock");
+}
+
+
+/* Find the segment with KEY that has not been removed.
+   shm_lock must be held. */
+static struct shm_segment *
+find_segment(int key)
+{
+  struct list_elem *e;
+
+  for(e = list_begin(&segments); e != list_end(&segments); e = list_next(e)) {
+    struct shm_segment *seg = list_entry(e, struct shm_segment, elem);
+    if(seg->key == key)
+      return seg;
+  }
+  return NULL;
+}
+
+
+/* Create a segment of SIZE bytes, rounded up to whole pages,
+   named KEY.  Its pages are zero until written.  Returns false
+   if KEY is taken, SIZE is 0 or too big, or memory is short. */
+bool
+shm_create(int key, size_t size)
+{
+  size_t page_cnt = DIV_ROUND_UP(size, PGSIZE);
+  struct shm_segment *seg;
+  size_t i;
+
+  if(page_cnt == 0 || page_cnt > SHM_MAX_PAGES)
+    return false;
+
+  lock_acquire(&shm_lock);
+  if(find_segment(key) != NULL) {
+    lock_release(&shm_lock);
+    return false;
+  }
+
+  seg = malloc(sizeof *seg);
+  if(seg != NULL)
+    seg->pages = malloc(page_cnt * sizeof *seg->pages);
+  if(seg == NULL || seg->pages == NULL) {
+    free(seg);
+    lock_release(&shm_lock);
+    return false;
+  }
+  seg->key = key;
+  seg->page_cnt = page_cnt;
+  list_init(&seg->attachments);
+  seg->removed = false;
+  for(i = 0; i < page_cnt; i++) {
+    seg->pages[i].seg = seg;
+    seg->pages[i].kpage = NULL;
+    seg->pages[i].swapped = false;
+  }
+  list_push_back(&segments, &seg->elem);
+  lock_release(&shm_lock);
+
+  return true;
+}
+
+
+/* Remove the segment named KEY, so that it can no longer be
+   attached and KEY may be reused.  Processes that have it
+   attached keep it until they detach.  Returns false if there is
+   no such segment. */
+bool
+shm_remove(int key)
+{
+  struct shm_segment *seg;
+
+  lock_acquire(&shm_lock);
+  seg = find_segment(key);
+  if(seg != NULL) {
+    seg->removed = true;
+    list_remove(&seg->elem);
+    if(list_empty(&seg->attachments))
+      destroy_segment(seg);
+  }
+  lock_release(&shm_lock);
+
+  return seg != NULL;
+}
+
+
+/* Attach the segment named KEY to the current process at ADDR,
+   which must be page-aligned and have room for the whole
+   segment.  Pages are mapped lazily, on first touch.  Returns
+   ADDR, or a null pointer on failure. */
+void *
+shm_attach(int key, void *addr)
+{
+  struct thread *t = thread_current();
+  struct shm_segment *seg;
+  struct shm_attachment *a;
+  size_t i;
+
+  if(addr == NULL || pg_ofs(addr) != 0 || addr < (void *) 0x08048000
+     || !is_user_vaddr(addr))
+    return NULL;
+
+  lock_acquire(&shm_lock);
+  seg = find_segment(key);
+  a = seg != NULL ? malloc(sizeof *a) : NULL;
+  if(a == NULL
+     || (size_t) ((uint8_t *) PHYS_BASE - (uint8_t *) addr)
+        < seg->page_cnt * PGSIZE) {
+    free(a);
+    lock_release(&shm_lock);
+    return NULL;
+  }
+  a->seg = seg;
+  a->t = t;
+  a->base = addr;
+
+  for(i = 0; i < seg->page_cnt; i++) {
+    struct spt_entry *spte = malloc(sizeof *spte);
+    if(spte != NULL) {
+      memset(spte, 0, sizeof *spte);
+      spte->upage = a->base + i * PGSIZE;
+      spte->writable = true;
+      spte->zero_bytes = PGSIZE;
+      spte->shm = &seg->pages[i];
+    }
+    if(spte == NULL || !spt_insert(spte)) {
+      // Something is already mapped there: undo.
+      free(spte);
+      while(i-- > 0) {
+        spte = get_spte(a->base + i * PGSIZE);
+        spt_remove(spte);
+        free(spte);
+      }
+      free(a);
+      lock_release(&shm_lock);
+      return NULL;
+    }
+  }
+  list_push_back(&seg->attachments, &a->seg_elem);
+  list_push_back(&t->shm_list, &a->thread_elem);
+  lock_release(&shm_lock);
+
+  return addr;
+}
+
+
+/* Detach the segment attached at ADDR from the current process.
+   Returns false if no segment is attached there. */
+bool
+shm_detach(void *addr)
+{
+  struct thread *t = thread_current();
+  struct list_elem *e;
+  bool found = false;
+
+  lock_acquire(&shm_lock);
+  for(e = list_begin(&t->shm_list); e != list_end(&t->shm_list);
+      e = list_next(e)) {
+    struct shm_attachment *a = list_entry(e, struct shm_attachment,
+                                          thread_elem);
+    if(a->base == addr) {
+      detach(a);
+      found = true;
+      break;
+    }
+  }
+  lock_release(&shm_lock);
+
+  return found;
+}
+
+
+/* Detach every segment from the current process, which is
+   exiting. */
+void
+shm_detach_all(void)
+{
+  struct thread *t = thread_current();
+
+  lock_acquire(&shm_lock);
+  while(!list_empty(&t->shm_list))
+    detach(list_entry(list_front(&t->shm_list), struct shm_attachment,
+                      thread_elem));
+  lock_release(&shm_lock);
+}
+
+
+/* Unmap attachment A, which belongs to the current process, and
+   free it, destroying its segment if that was the last use.
+   shm_lock must be held. */
+static void
+detach(struct shm_attachment *a)
+{
+  struct shm_segment *seg = a->seg;
+  size_t i;
+
+  for(i = 0; i < seg->page_cnt; i++) {
+    uint8_t *upage = a->base + i * PGSIZE;
+    struct spt_entry *spte = get_spte(upage);
+
+    pagedir_clear_page(a->t->pagedir, upage);
+    spt_remove(spte);
+    free(spte);
+  }
+  list_remove(&a->seg_elem);
+  list_remove(&a->thread_elem);
+  free(a);
+
+  if(seg->removed && list_empty(&seg->attachments))
+    destroy_segment(seg);
+}
+
+
+/* Free SEG with its frames and swap slots.  shm_lock must be
+   held. */
+static void
+destroy_segment(struct shm_segment *seg)
+{
+  size_t i;
+
+  for(i = 0; i < seg->page_cnt; i++) {
+    struct shm_page *page = &seg->pages[i];
+    if(page->kpage != NULL)
+      free_frame(page->kpage);
+    else if(page->swapped)
+      swap_free(page->swap_slot);
+  }
+  free(seg->pages);
+  free(seg);
+}
+
+
+/* Map SPTE's shared page into the current process, first
+   bringing it into memory from swap or as a zeroed page if no
+   process has it in memory. */
+bool
+shm_load_page(struct spt_entry *spte)
+{
+  struct thread *t = thread_current();
+  struct shm_page *page = spte->shm;
+  uint8_t *kpage = NULL;
+  bool success;
+
+  if(pagedir_get_page(t->pagedir, spte->upage) != NULL)
+    return true;
+
+  // Allocate the frame before taking shm_lock, since doing so
+  // may evict another shared frame.  Until page->kpage points
+  // at it, frame_evict() passes this frame over.
+  lock_acquire(&shm_lock);
+  if(page->kpage == NULL) {
+    lock_release(&shm_lock);
+    kpage = palloc_get_shared_frame(PAL_USER, page);
+    lock_acquire(&shm_lock);
+  }
+  if(page->kpage != NULL) {
+    // Another process brought the page in while we waited.
+    if(kpage != NULL)
+      free_frame(kpage);
+  }
+  else if(kpage == NULL) {
+    lock_release(&shm_lock);
+    return false;
+  }
+  else {
+    if(page->swapped) {
+      swap_read(page->swap_slot, kpage, spte->upage);
+      page->swapped = false;
+    }
+    else
+      memset(kpage, 0, PGSIZE);
+    page->kpage = kpage;
+  }
+  spte->frame = page->kpage;
+  success = install_page(spte->upage, page->kpage, spte->writable);
+  lock_release(&shm_lock);
+
+  return success;
+}
+
+
+/* Called by frame_evict(), with frame_lock held, for KPAGE, the
+   frame of shared page PAGE.  Gives the page a second chance if
+   any attached process has touched it since the last call, and
+   otherwise unmaps it everywhere and swaps it out.  Returns true
+   if the caller may free KPAGE. */
+bool
+shm_evict_frame(struct shm_page *page, void *kpage)
+{
+  struct shm_segment *seg;
+  size_t ofs;
+  bool accessed = false;
+  struct list_elem *e;
+
+  // If the lock is busy, or the page is still being loaded,
+  // try another frame.
+  if(!lock_try_acquire(&shm_lock))
+    return false;
+  if(page->kpage != kpage) {
+    lock_release(&shm_lock);
+    return false;
+  }
+  seg = page->seg;
+  ofs = (page - seg->pages) * PGSIZE;
+
+  for(e = list_begin(&seg->attachments); e != list_end(&seg->attachments);
+      e = list_next(e)) {
+    struct shm_attachment *a = list_entry(e, struct shm_attachment, seg_elem);
+    if(pagedir_is_accessed(a->t->pagedir, a->base + ofs)) {
+      pagedir_set_accessed(a->t->pagedir, a->base + ofs, false);
+      accessed = true;
+    }
+  }
+  if(accessed) {
+    lock_release(&shm_lock);
+    return false;
+  }
+
+  // Unmap first, so no process can write to the page while it
+  // is being written out.
+  for(e = list_begin(&seg->attachments); e != list_end(&seg->attachments);
+      e = list_next(e)) {
+    struct shm_attachment *a = list_entry(e, struct shm_attachment, seg_elem);
+    pagedir_clear_page(a->t->pagedir, a->base + ofs);
+  }
+  page->swap_slot = swap_write(kpage, NULL);
+  page->swapped = true;
+  page->kpage = NULL;
+  lock_release(&shm_lock);
+
+  return true;
+}
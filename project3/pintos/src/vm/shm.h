@@ -0,0 +1,22 @@
+#ifndef VM_SHM_H
+#define VM_SHM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct spt_entry;
+struct shm_page;
+
+/* Most pages in one shared memory segment. */
+#define SHM_MAX_PAGES 1024
+
+void shm_init(void);
+bool shm_create(int key, size_t size);
+bool shm_remove(int key);
+void *shm_attach(int key, void *addr);
+bool shm_detach(void *addr);
+void shm_detach_all(void);
+bool shm_load_page(struct spt_entry *spte);
+bool shm_evict_frame(struct shm_page *page, void *kpage);
+
+#endif /* vm/shm.h */
@@ -4,6 +4,7 @@
 #include <debug.h>
 #include "threads/vaddr.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include "devices/block.h"
 #include "userprog/syscall.h"
 #include "vm/swap.h"
@@ -32,54 +33,81 @@ swap_init(void)
 
   //initital swap lock.
   lock_init(&swap_lock);  
+  lock_profile(&swap_lock, "swap_lock");
 }
 
 
-/* Swap in. */
-void
-swap_in (struct spt_entry *spte)
+/* Writes the page at KPAGE to a free swap slot and returns the
+   slot.  UPAGE is the page's user address, only for tracing. */
+size_t
+swap_write (const void *kpage, const void *upage)
 {
-  size_t i;
+  if(!swap_bitmap)
+    exit(-1);
   lock_acquire(&swap_lock);
 
-  bitmap_flip(swap_bitmap, spte->swap_sector);
+  // Get a free sector
+  size_t free_sector = bitmap_scan_and_flip(swap_bitmap, 0, 1, 0);
+  if(free_sector == BITMAP_ERROR)
+    PANIC("swap is full");
+  TRACE (TRACE_SWAP_OUT, free_sector, upage, 0);
 
-  /* Read page back to memory. */
-  for(i = 0; i < SECTOR_NUM; i++) {
-    block_read(swap_block, spte->swap_sector * SECTOR_NUM + i,
-	       spte->upage + i * BLOCK_SECTOR_SIZE);
-  }
+  // Record the page to this sector.
+  block_write_multiple(swap_block, free_sector * SECTOR_NUM,
+                       SECTOR_NUM, kpage);
   
   lock_release(&swap_lock);
-
-  spte->swap = false;
-  spte->loaded = true;
+  return free_sector;
 }
 
 
-/* Swap out. */
+/* Reads swap slot SLOT into the page at KPAGE and frees the
+   slot.  UPAGE is the page's user address, only for tracing. */
 void
-swap_out (struct spt_entry *spte)
+swap_read (size_t slot, void *kpage, const void *upage)
 {
-  if(!swap_bitmap)
-    exit(-1);
   lock_acquire(&swap_lock);
 
-  // Get a free sector
-  size_t free_sector = bitmap_scan_and_flip(swap_bitmap, 0, 1, 0);
-  size_t i;
+  bitmap_flip(swap_bitmap, slot);
+  TRACE (TRACE_SWAP_IN, slot, upage, 0);
 
-  // Record the page to this sector.
-  for(i = 0; i < SECTOR_NUM; i++) {
-    block_write(swap_block, free_sector * SECTOR_NUM + i,
-		spte->upage + i * BLOCK_SECTOR_SIZE);
-  }
+  /* Read page back to memory. */
+  block_read_multiple(swap_block, slot * SECTOR_NUM, SECTOR_NUM, kpage);
   
   lock_release(&swap_lock);
+}
+
 
+/* Frees swap slot SLOT without reading it. */
+void
+swap_free (size_t slot)
+{
+  lock_acquire(&swap_lock);
+  bitmap_reset(swap_bitmap, slot);
+  lock_release(&swap_lock);
+}
+
+
+/* Swap in SPTE's page to KPAGE, the kernel address of its frame.
+   Using the kernel address lets the disk DMA straight into the
+   frame. */
+void
+swap_in (struct spt_entry *spte, void *kpage)
+{
+  swap_read(spte->swap_sector, kpage, spte->upage);
+  spte->swap = false;
+  spte->loaded = true;
+}
+
+
+/* Swap out SPTE's page from KPAGE, the kernel address of its
+   frame.  The page may belong to a process other than the
+   running one, so its user address cannot be used. */
+void
+swap_out (struct spt_entry *spte, void *kpage)
+{
   // record swap sector and set "swap" to true.
-  spte->swap_sector = free_sector;
+  spte->swap_sector = swap_write(kpage, spte->upage);
   spte->swap = true;
   spte->loaded = false;
 }
-
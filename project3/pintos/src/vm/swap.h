@@ -9,7 +9,10 @@ struct bitmap *swap_bitmap;
 struct lock swap_lock;
 
 void swap_init(void);
-void swap_in (struct spt_entry *spte);
-void swap_out (struct spt_entry *spte);
+size_t swap_write (const void *kpage, const void *upage);
+void swap_read (size_t slot, void *kpage, const void *upage);
+void swap_free (size_t slot);
+void swap_in (struct spt_entry *spte, void *kpage);
+void swap_out (struct spt_entry *spte, void *kpage);
 
 #endif /* vm/swap.h */